@@ -0,0 +1,45 @@
+#include "AssetLoader.hpp"
+
+#include <chrono>
+
+AssetLoader::AssetLoader(size_t thread_count) : pool(thread_count) {
+}
+
+void AssetLoader::load(std::function< Finish() > const &read) {
+	std::shared_ptr< Request > request = std::make_shared< Request >();
+	requests.emplace_back(request);
+	pool.enqueue([this, request, read]() {
+		Finish finish;
+		std::exception_ptr error;
+		try {
+			finish = read();
+		} catch (...) {
+			error = std::current_exception();
+		}
+		std::unique_lock< std::mutex > lock(mutex);
+		request->finish = std::move(finish);
+		request->error = error;
+		request->ready = true;
+	});
+}
+
+void AssetLoader::update(float budget) {
+	auto before = std::chrono::steady_clock::now();
+	while (!requests.empty()) {
+		std::shared_ptr< Request > request = requests.front();
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			if (!request->ready) break;
+		}
+		requests.pop_front();
+		if (request->error) std::rethrow_exception(request->error);
+		if (request->finish) request->finish();
+
+		float elapsed = std::chrono::duration< float >(std::chrono::steady_clock::now() - before).count();
+		if (elapsed >= budget) break;
+	}
+}
+
+size_t AssetLoader::pending() const {
+	return requests.size();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+//AssetLoader reads assets on background threads and finishes them on the main thread:
+// a load is a 'read' step (file I/O, parsing, checking -- no OpenGL) that runs on a loader thread
+// and returns a 'finish' step (creating GL objects, adding things to the scene), which is queued
+// for the main thread to run from update(), a few at a time, so a frame is never stalled for long.
+//Finish steps run in the order their loads were requested, so a later load can rely on an
+// earlier one (e.g., a scene that refers to meshes) no matter which read completes first.
+struct AssetLoader {
+	explicit AssetLoader(size_t thread_count = 2);
+	AssetLoader(AssetLoader const &) = delete;
+	AssetLoader &operator=(AssetLoader const &) = delete;
+
+	typedef std::function< void() > Finish;
+	//queue up a load; 'read' runs on a loader thread and returns the step to run on the main thread:
+	void load(std::function< Finish() > const &read);
+
+	//(main thread) run ready finish steps, in request order, until 'budget' seconds have been spent:
+	// (one step always runs if ready, so an over-budget step still makes progress)
+	// note: rethrows whatever a read step threw, when that load's turn comes up.
+	void update(float budget);
+
+	//loads requested but not yet finished:
+	size_t pending() const;
+
+	//internals:
+	struct Request {
+		bool ready = false; //read step done (guarded by 'mutex')
+		Finish finish;
+		std::exception_ptr error;
+	};
+	std::deque< std::shared_ptr< Request > > requests; //in request order; only touched by the main thread
+	mutable std::mutex mutex;
+	ThreadPool pool; //(last, so its threads finish any running reads before the rest goes away)
+};
@@ -0,0 +1,80 @@
+//Checks that VolleyballBatch, at every kernel width compiled in, gives bit-identical results to stepping each
+// match on its own with VolleyballSim::step (which relies on -ffp-contract=off; see VolleyballKernel.hpp).
+// Build with 'jam batch_test' and run dist/batch_test; exits nonzero on failure.
+
+#include "VolleyballBatch.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//compare every state field byte for byte (not the whole struct, whose padding bytes are arbitrary):
+static bool same_bits(VolleyballSim const &a, VolleyballSim const &b) {
+	auto same = [](void const *x, void const *y, size_t size) { return std::memcmp(x, y, size) == 0; };
+	#define SAME(FIELD) same(&a.FIELD, &b.FIELD, sizeof(a.FIELD))
+	return SAME(p1.x) && SAME(p1.y) && SAME(p1.vel_y) && SAME(p1.can_jump) && SAME(p1.jumped)
+		&& SAME(p2.x) && SAME(p2.y) && SAME(p2.vel_y) && SAME(p2.can_jump) && SAME(p2.jumped)
+		&& SAME(ball_x) && SAME(ball_y) && SAME(ball_vel_x) && SAME(ball_vel_y)
+		&& SAME(p1_score) && SAME(p2_score) && SAME(p1_touch_last) && SAME(game_over);
+	#undef SAME
+}
+
+int main() {
+	bool ok = true;
+
+	size_t const Matches = 2003; //(not a multiple of any width, so leftover matches are stepped one at a time too)
+	uint32_t const Steps = 3000;
+	float const dt = 1.0f / 60.0f;
+
+	//varied starting states, some with balls fast enough to be sub-stepped:
+	std::mt19937 mt(0x0b0115);
+	auto uniform = [&mt](float lo, float hi) { return lo + (hi - lo) * float(mt() % 100000) / 100000.0f; };
+	std::vector< VolleyballSim > initial(Matches);
+	for (auto &sim : initial) {
+		sim.p1.x = uniform(-9.0f, -1.0f);
+		sim.p2.x = uniform(1.0f, 9.0f);
+		sim.ball_x = uniform(-8.0f, 8.0f);
+		sim.ball_y = uniform(1.0f, 6.0f);
+		sim.ball_vel_x = uniform(-20.0f, 20.0f);
+		sim.ball_vel_y = uniform(-10.0f, 10.0f);
+	}
+	//random controls for every match and step:
+	std::vector< std::vector< VolleyballSim::Inputs > > inputs(Steps, std::vector< VolleyballSim::Inputs >(Matches));
+	for (auto &step : inputs) {
+		for (auto &in : step) in = VolleyballSim::Inputs::from_bits(uint8_t(mt() & 0x3f));
+	}
+
+	//reference: one match at a time:
+	std::vector< VolleyballSim > expected = initial;
+	for (uint32_t s = 0; s < Steps; ++s) {
+		for (size_t m = 0; m < Matches; ++m) expected[m].step(dt, inputs[s][m]);
+	}
+
+	ThreadPool pool(4);
+	for (size_t width : VolleyballBatch::lane_widths()) {
+		for (bool threaded : {false, true}) {
+			VolleyballBatch batch;
+			batch.lane_width = width;
+			batch.grain = 256;
+			batch.reset(Matches, initial[0]);
+			for (size_t m = 0; m < Matches; ++m) batch.set(m, initial[m]);
+			for (uint32_t s = 0; s < Steps; ++s) {
+				batch.step(dt, inputs[s].data(), threaded ? &pool : nullptr);
+			}
+			size_t differ = 0;
+			for (size_t m = 0; m < Matches; ++m) {
+				if (!same_bits(batch.get(m), expected[m])) differ += 1;
+			}
+			if (differ) {
+				std::cerr << "FAILED: " << differ << " of " << Matches << " matches differ from VolleyballSim::step with "
+					<< width << " lanes" << (threaded ? " on a thread pool" : "") << "." << std::endl;
+				ok = false;
+			}
+		}
+	}
+
+	if (ok) std::cout << "batch_test: all checks passed." << std::endl;
+	return ok ? 0 : 1;
+}
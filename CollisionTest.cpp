@@ -0,0 +1,211 @@
+//Checks CollisionWorld's narrowphase and grid, and that a match played against scenery keeps the tuned court.
+// Build with 'jam collision_test' and run dist/collision_test; exits nonzero on failure.
+
+#include "CollisionWorld.hpp"
+#include "VolleyballSim.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+static bool check(bool ok, char const *what) {
+	if (!ok) std::cerr << "FAILED: " << what << std::endl;
+	return ok;
+}
+
+static bool near(float a, float b) {
+	return std::abs(a - b) < 1e-4f;
+}
+
+static CollisionWorld::Box box(float min_x, float min_y, float max_x, float max_y) {
+	CollisionWorld::Box b;
+	b.min_x = min_x;
+	b.min_y = min_y;
+	b.max_x = max_x;
+	b.max_y = max_y;
+	return b;
+}
+
+int main() {
+	bool ok = true;
+
+	{ //ball vs box: pushed out along the contact normal, velocity reflected only if moving in:
+		CollisionWorld world;
+		world.add(box(0.0f, 0.0f, 2.0f, 2.0f));
+		world.build();
+
+		float x = 2.2f, y = 1.0f, vel_x = -3.0f, vel_y = 1.0f;
+		ok = check(world.collide_ball(x, y, vel_x, vel_y, 0.35f), "ball overlapping a side hits it") && ok;
+		ok = check(near(x, 2.35f) && near(y, 1.0f), "ball is pushed out to just touch the side") && ok;
+		ok = check(near(vel_x, 3.0f) && near(vel_y, 1.0f), "velocity into the side is reflected") && ok;
+
+		x = 2.2f; y = 1.0f; vel_x = 3.0f; vel_y = 0.0f;
+		world.collide_ball(x, y, vel_x, vel_y, 0.35f);
+		ok = check(near(vel_x, 3.0f), "velocity already leaving the box is kept") && ok;
+
+		//near a corner, the push is diagonal:
+		x = 2.2f; y = 2.2f; vel_x = -1.0f; vel_y = -1.0f;
+		world.collide_ball(x, y, vel_x, vel_y, 0.35f);
+		float s = 0.35f / std::sqrt(2.0f);
+		ok = check(near(x, 2.0f + s) && near(y, 2.0f + s), "ball near a corner is pushed out diagonally") && ok;
+		ok = check(near(vel_x, 1.0f) && near(vel_y, 1.0f), "velocity into a corner is reflected along the diagonal") && ok;
+
+		//center inside: leaves through the nearest side:
+		x = 1.9f; y = 1.0f; vel_x = 0.0f; vel_y = 0.0f;
+		world.collide_ball(x, y, vel_x, vel_y, 0.35f);
+		ok = check(near(x, 2.35f) && near(y, 1.0f), "ball inside the box leaves through the nearest side") && ok;
+
+		x = 3.0f; y = 1.0f; vel_x = -1.0f; vel_y = 0.0f;
+		ok = check(!world.collide_ball(x, y, vel_x, vel_y, 0.35f) && vel_x == -1.0f, "ball clear of the box is untouched") && ok;
+	}
+
+	{ //player box landing on top of an obstacle can jump again; hitting the underside stops upward motion:
+		CollisionWorld world;
+		world.add(box(-1.0f, 0.0f, 1.0f, 1.0f));
+		world.build();
+
+		float x = 0.0f, y = 1.4f, vel_y = -2.0f;
+		bool landed = false;
+		ok = check(world.collide_box(x, y, 0.5f, 0.5f, vel_y, &landed), "falling box overlapping the top hits it") && ok;
+		ok = check(landed, "landing on top is reported") && ok;
+		ok = check(near(y, 1.5f) && vel_y == 0.0f, "landed box rests on top with no vertical velocity") && ok;
+
+		x = 0.0f; y = -0.4f; vel_y = 2.0f;
+		world.collide_box(x, y, 0.5f, 0.5f, vel_y, &landed);
+		ok = check(!landed && near(y, -0.5f) && vel_y == 0.0f, "rising box is stopped under the obstacle without landing") && ok;
+
+		x = 1.3f; y = 0.5f; vel_y = 0.0f;
+		world.collide_box(x, y, 0.5f, 0.5f, vel_y, &landed);
+		ok = check(!landed && near(x, 1.5f), "box overlapping a side is pushed out sideways") && ok;
+
+		//a landed player can jump again in the sim:
+		VolleyballSim sim;
+		sim.p1.x = -0.8f;
+		sim.p1.y = 1.6f;
+		sim.p1.can_jump = false;
+		for (int i = 0; i < 30; ++i) sim.step(1.0f / 60.0f, VolleyballSim::Inputs(), &world);
+		ok = check(sim.p1.can_jump && near(sim.p1.y, 1.5f), "player landing on an obstacle can jump again") && ok;
+	}
+
+	{ //grid query: each overlapping obstacle once, in index order, whatever the cells:
+		CollisionWorld world;
+		world.cell_size = 1.0f;
+		world.add(box(4.0f, 0.0f, 5.0f, 1.0f)); //0: one cell
+		world.add(box(0.0f, 0.0f, 6.0f, 0.5f)); //1: spans many cells
+		world.add(box(2.5f, 0.2f, 4.5f, 3.0f)); //2: spans many cells, overlapping both others
+		world.add(box(9.0f, 9.0f, 10.0f, 10.0f)); //3: far away
+		world.build();
+
+		std::vector< uint32_t > candidates;
+		world.query(2.0f, 0.0f, 5.5f, 2.0f, &candidates);
+		ok = check(candidates == std::vector< uint32_t >({0, 1, 2}), "query lists overlapping obstacles once each, in index order") && ok;
+
+		std::vector< uint32_t > again;
+		world.query(4.2f, 0.1f, 4.3f, 0.3f, &again);
+		ok = check(again == std::vector< uint32_t >({0, 1, 2}), "a query within one shared cell gives the same order") && ok;
+
+		world.query(-5.0f, -5.0f, -4.0f, -4.0f, &candidates);
+		ok = check(candidates == std::vector< uint32_t >({1}), "queries beyond the grid land in its edge cells") && ok;
+	}
+
+	{ //with scenery side walls (inner faces at +/-10, as in scene.blob), the ball stays within the tuned +/-WallX:
+		CollisionWorld world;
+		float const inf = std::numeric_limits< float >::infinity();
+		world.add(box(-10.5f, 0.0f, -10.0f, inf));
+		world.add(box(10.0f, 0.0f, 10.5f, inf));
+		world.build();
+
+		VolleyballSim sim;
+		sim.ball_x = 5.0f;
+		sim.ball_y = 6.0f;
+		sim.ball_vel_x = 9.0f;
+		float widest = 0.0f;
+		for (int i = 0; i < 600 && !sim.game_over; ++i) {
+			sim.step(1.0f / 60.0f, VolleyballSim::Inputs(), &world);
+			widest = std::max(widest, std::abs(sim.ball_x));
+		}
+		ok = check(widest <= VolleyballSim::WallX, "scenery walls don't widen the court past WallX") && ok;
+	}
+
+	{ //sweeps: the slab test on a box's flat side, and the rounded corners of the grown box:
+		CollisionWorld world;
+		world.add(box(0.0f, 0.0f, 0.1f, 2.0f)); //(thinner than one step of a fast ball)
+		world.build();
+
+		float t, nx, ny;
+		ok = check(world.sweep_ball(-1.0f, 1.0f, 2.0f, 0.0f, 0.35f, &t, &nx, &ny), "sweep across a thin box hits it") && ok;
+		ok = check(near(t, 0.325f) && nx == -1.0f && ny == 0.0f, "sweep stops at the side, with the side's normal") && ok;
+
+		//passing the top-left corner diagonally -- through the grown box's square corner, but outside its rounded one:
+		ok = check(!world.sweep_ball(-1.3f, 1.3f, 2.0f, 2.0f, 0.35f, &t, &nx, &ny), "sweep past a rounded corner misses") && ok;
+		ok = check(world.sweep_ball(-1.0f, 2.2f, 2.0f, 0.0f, 0.35f, &t, &nx, &ny), "sweep clipping a corner hits it") && ok;
+		float cy = 0.2f / 0.35f;
+		ok = check(near(ny, cy) && near(nx, -std::sqrt(1.0f - cy * cy)), "corner hit has the corner's normal") && ok;
+
+		ok = check(!world.sweep_ball(-1.0f, 1.0f, 0.5f, 0.0f, 0.35f, &t, &nx, &ny), "sweep that stops short misses") && ok;
+	}
+
+	{ //move_ball makes the whole move, bouncing as often as it needs to:
+		CollisionWorld world;
+		world.add(box(-1.0f, -100.0f, -0.5f, 100.0f));
+		world.add(box(0.5f, -100.0f, 1.0f, 100.0f));
+		world.build();
+
+		//(a zig-zag down a corridor 0.3 wider than the ball takes many more than four bounces)
+		float x = 0.0f, y = 0.0f, vel_x = 1.0f, vel_y = 1.0f;
+		ok = check(world.move_ball(x, y, 3.0f, 10.0f, vel_x, vel_y, 0.35f), "ball moving along a corridor bounces") && ok;
+		ok = check(near(y, 10.0f), "the whole move is made, however many bounces it takes") && ok;
+		ok = check(x >= -0.15f - 1e-4f && x <= 0.15f + 1e-4f, "the ball stays within the corridor") && ok;
+	}
+
+	{ //a ball wedged between two obstacles it exactly fits between stops (the stall guard) instead of spinning:
+		CollisionWorld world;
+		world.add(box(-1.0f, -1.0f, -0.35f, 1.0f));
+		world.add(box(0.35f, -1.0f, 1.0f, 1.0f));
+		world.build();
+
+		float x = 0.0f, y = 0.0f, vel_x = 5.0f, vel_y = 0.0f;
+		ok = check(world.move_ball(x, y, 1.0f, 0.0f, vel_x, vel_y, 0.35f), "wedged ball hits its obstacles") && ok;
+		ok = check(x == 0.0f && y == 0.0f, "wedged ball stays put") && ok;
+	}
+
+	{ //a ball moving faster than the net is thick (0.4) is still stopped by it:
+		VolleyballSim sim;
+		sim.ball_x = -0.45f;
+		sim.ball_y = 0.7f;
+		sim.ball_vel_x = 60.0f; //(1.0 per 1/60 step)
+		bool crossed = false;
+		for (int i = 0; i < 5 && sim.p1_score + sim.p2_score == 0; ++i) {
+			sim.step(1.0f / 60.0f, VolleyballSim::Inputs());
+			if (sim.p1_score + sim.p2_score == 0 && sim.ball_x > 0.4f) crossed = true;
+		}
+		ok = check(!crossed && sim.p1_score + sim.p2_score == 1, "fast ball hits the net instead of passing through it") && ok;
+	}
+
+	{ //at ordinary speeds step() takes one sub-step, so it is exactly the single step the game was tuned with:
+		bool same = true;
+		for (float vel_x = -9.0f; vel_x <= 9.0f; vel_x += 1.5f) {
+			for (float vel_y = -8.0f; vel_y <= 8.0f; vel_y += 2.0f) {
+				if (VolleyballSim::substeps_for(vel_x, vel_y, 1.0f / 60.0f) != 1) same = false;
+				VolleyballSim a;
+				a.ball_x = -4.0f;
+				a.ball_vel_x = vel_x;
+				a.ball_vel_y = vel_y;
+				VolleyballSim b = a;
+				VolleyballSim::Inputs inputs;
+				inputs.p1_right = true;
+				a.step(1.0f / 60.0f, inputs);
+				b.step_once(1.0f / 60.0f, inputs);
+				if (std::memcmp(&a, &b, sizeof(VolleyballSim)) != 0) same = false;
+			}
+		}
+		ok = check(same, "normal-speed steps aren't sub-stepped and match step_once") && ok;
+		ok = check(VolleyballSim::substeps_for(60.0f, 0.0f, 1.0f / 60.0f) > 1, "fast balls are sub-stepped") && ok;
+	}
+
+	if (ok) std::cout << "collision_test: all checks passed." << std::endl;
+	return ok ? 0 : 1;
+}
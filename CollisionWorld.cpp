@@ -0,0 +1,291 @@
+#include "CollisionWorld.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+void CollisionWorld::add(Box const &box) {
+	assert(box.min_x <= box.max_x && box.min_y <= box.max_y);
+	boxes.emplace_back(box);
+}
+
+void CollisionWorld::clear() {
+	boxes.clear();
+	build();
+}
+
+void CollisionWorld::build() {
+	//grid bounds from the finite box coordinates:
+	float min_x = std::numeric_limits< float >::infinity();
+	float min_y = std::numeric_limits< float >::infinity();
+	float max_x = -std::numeric_limits< float >::infinity();
+	float max_y = -std::numeric_limits< float >::infinity();
+	auto include = [](float v, float &lo, float &hi) {
+		if (std::isfinite(v)) {
+			lo = std::min(lo, v);
+			hi = std::max(hi, v);
+		}
+	};
+	for (auto const &box : boxes) {
+		include(box.min_x, min_x, max_x);
+		include(box.max_x, min_x, max_x);
+		include(box.min_y, min_y, max_y);
+		include(box.max_y, min_y, max_y);
+	}
+	if (!(min_x <= max_x)) min_x = max_x = 0.0f;
+	if (!(min_y <= max_y)) min_y = max_y = 0.0f;
+	assert(cell_size > 0.0f);
+	grid_x = min_x;
+	grid_y = min_y;
+	columns = uint32_t(std::floor((max_x - min_x) / cell_size)) + 1;
+	rows = uint32_t(std::floor((max_y - min_y) / cell_size)) + 1;
+
+	//count obstacles per cell, then fill (a counting sort, so each cell's list is contiguous):
+	cell_begin.assign(columns * rows + 1, 0);
+	for (auto const &box : boxes) {
+		uint32_t c0, r0, c1, r1;
+		cell_range(box.min_x, box.min_y, box.max_x, box.max_y, &c0, &r0, &c1, &r1);
+		for (uint32_t r = r0; r <= r1; ++r) {
+			for (uint32_t c = c0; c <= c1; ++c) {
+				cell_begin[r * columns + c + 1] += 1;
+			}
+		}
+	}
+	for (uint32_t i = 1; i < cell_begin.size(); ++i) {
+		cell_begin[i] += cell_begin[i-1];
+	}
+	cell_items.assign(cell_begin.back(), 0);
+	std::vector< uint32_t > fill(cell_begin.begin(), cell_begin.end() - 1);
+	for (uint32_t i = 0; i < boxes.size(); ++i) {
+		uint32_t c0, r0, c1, r1;
+		cell_range(boxes[i].min_x, boxes[i].min_y, boxes[i].max_x, boxes[i].max_y, &c0, &r0, &c1, &r1);
+		for (uint32_t r = r0; r <= r1; ++r) {
+			for (uint32_t c = c0; c <= c1; ++c) {
+				cell_items[fill[r * columns + c]++] = i;
+			}
+		}
+	}
+
+	stamps.assign(boxes.size(), 0);
+	stamp = 0;
+}
+
+void CollisionWorld::cell_range(float min_x, float min_y, float max_x, float max_y, uint32_t *c0, uint32_t *r0, uint32_t *c1, uint32_t *r1) const {
+	//(clamped in float first, so infinite coordinates are safe to convert)
+	auto cell = [this](float v, float origin, uint32_t count) -> uint32_t {
+		float f = std::floor((v - origin) / cell_size);
+		f = std::max(0.0f, std::min(float(count - 1), f));
+		return uint32_t(f);
+	};
+	*c0 = cell(min_x, grid_x, columns);
+	*c1 = cell(max_x, grid_x, columns);
+	*r0 = cell(min_y, grid_y, rows);
+	*r1 = cell(max_y, grid_y, rows);
+}
+
+void CollisionWorld::query(float min_x, float min_y, float max_x, float max_y, std::vector< uint32_t > *candidates) const {
+	assert(candidates);
+	candidates->clear();
+	if (boxes.empty()) return;
+	assert(stamps.size() == boxes.size() && "call build() after add()");
+
+	stamp += 1;
+	if (stamp == 0) { //(wrapped around; old stamps could collide)
+		std::fill(stamps.begin(), stamps.end(), 0);
+		stamp = 1;
+	}
+
+	uint32_t c0, r0, c1, r1;
+	cell_range(min_x, min_y, max_x, max_y, &c0, &r0, &c1, &r1);
+	for (uint32_t r = r0; r <= r1; ++r) {
+		for (uint32_t c = c0; c <= c1; ++c) {
+			uint32_t cell = r * columns + c;
+			for (uint32_t i = cell_begin[cell]; i < cell_begin[cell + 1]; ++i) {
+				uint32_t item = cell_items[i];
+				if (stamps[item] == stamp) continue;
+				stamps[item] = stamp;
+				candidates->emplace_back(item);
+			}
+		}
+	}
+	//(a fixed order keeps results independent of the grid layout)
+	std::sort(candidates->begin(), candidates->end());
+}
+
+bool CollisionWorld::collide_ball(float &x, float &y, float &vel_x, float &vel_y, float radius) const {
+	query(x - radius, y - radius, x + radius, y + radius, &scratch);
+	bool hit = false;
+	for (uint32_t index : scratch) {
+		Box const &box = boxes[index];
+		//closest point of the box to the ball's center:
+		float cx = std::max(box.min_x, std::min(box.max_x, x));
+		float cy = std::max(box.min_y, std::min(box.max_y, y));
+		float dx = x - cx;
+		float dy = y - cy;
+		float length2 = dx * dx + dy * dy;
+		if (length2 >= radius * radius) continue;
+
+		//contact normal (pointing out of the box) and the position that just touches it:
+		float nx, ny;
+		if (length2 > 0.0f) {
+			float length = std::sqrt(length2);
+			nx = dx / length;
+			ny = dy / length;
+			x = cx + nx * radius;
+			y = cy + ny * radius;
+		} else {
+			//center is inside the box; leave through the nearest side:
+			float left = x - box.min_x, right = box.max_x - x;
+			float below = y - box.min_y, above = box.max_y - y;
+			float least = std::min(std::min(left, right), std::min(below, above));
+			nx = ny = 0.0f;
+			if (least == left) { nx = -1.0f; x = box.min_x - radius; }
+			else if (least == right) { nx = 1.0f; x = box.max_x + radius; }
+			else if (least == below) { ny = -1.0f; y = box.min_y - radius; }
+			else { ny = 1.0f; y = box.max_y + radius; }
+		}
+
+		//reflect velocity if moving into the box:
+		float into = vel_x * nx + vel_y * ny;
+		if (into < 0.0f) {
+			vel_x -= 2.0f * into * nx;
+			vel_y -= 2.0f * into * ny;
+		}
+		hit = true;
+	}
+	return hit;
+}
+
+bool CollisionWorld::collide_box(float &x, float &y, float half_x, float half_y, float &vel_y, bool *landed) const {
+	if (landed) *landed = false;
+	query(x - half_x, y - half_y, x + half_x, y + half_y, &scratch);
+	bool hit = false;
+	for (uint32_t index : scratch) {
+		Box const &box = boxes[index];
+		//overlap along each axis (touching doesn't count):
+		float push_left = (x + half_x) - box.min_x; //move left by this much to clear
+		float push_right = box.max_x - (x - half_x);
+		float push_down = (y + half_y) - box.min_y;
+		float push_up = box.max_y - (y - half_y);
+		if (push_left <= 0.0f || push_right <= 0.0f || push_down <= 0.0f || push_up <= 0.0f) continue;
+
+		float least = std::min(std::min(push_left, push_right), std::min(push_down, push_up));
+		if (least == push_left) {
+			x -= push_left;
+		} else if (least == push_right) {
+			x += push_right;
+		} else if (least == push_down) {
+			y -= push_down;
+			if (vel_y > 0.0f) vel_y = 0.0f;
+		} else {
+			y += push_up;
+			if (vel_y < 0.0f) vel_y = 0.0f;
+			if (landed) *landed = true;
+		}
+		hit = true;
+	}
+	return hit;
+}
+
+bool CollisionWorld::sweep_ball(float x, float y, float dx, float dy, float radius, float *t, float *nx, float *ny) const {
+	assert(t && nx && ny);
+	query(std::min(x, x + dx) - radius, std::min(y, y + dy) - radius, std::max(x, x + dx) + radius, std::max(y, y + dy) + radius, &scratch);
+
+	float best = 1.0f;
+	bool found = false;
+	for (uint32_t index : scratch) {
+		Box const &box = boxes[index];
+
+		//ray vs the box grown by 'radius' (slab test); 'enter' is when the ray is inside both slabs:
+		float enter = -std::numeric_limits< float >::infinity();
+		float exit = std::numeric_limits< float >::infinity();
+		float hit_nx = 0.0f, hit_ny = 0.0f;
+		auto slab = [&](float p, float d, float lo, float hi, float normal_x, float normal_y) -> bool {
+			lo -= radius;
+			hi += radius;
+			if (d == 0.0f) return (lo < p && p < hi);
+			float s0 = (lo - p) / d;
+			float s1 = (hi - p) / d;
+			float sign = -1.0f; //(entering through 'lo', the normal points toward -axis)
+			if (s0 > s1) {
+				std::swap(s0, s1);
+				sign = 1.0f;
+			}
+			if (s0 > enter) {
+				enter = s0;
+				hit_nx = sign * normal_x;
+				hit_ny = sign * normal_y;
+			}
+			exit = std::min(exit, s1);
+			return true;
+		};
+		if (!slab(x, dx, box.min_x, box.max_x, 1.0f, 0.0f)) continue;
+		if (!slab(y, dy, box.min_y, box.max_y, 0.0f, 1.0f)) continue;
+		if (!(enter <= exit) || enter < 0.0f || enter >= best) continue; //(missed, already inside, or later)
+
+		//the grown box has rounded corners -- if the ray enters near a corner, test against that circle instead:
+		float hx = x + enter * dx;
+		float hy = y + enter * dy;
+		float corner_x = (hx < box.min_x ? box.min_x : (hx > box.max_x ? box.max_x : hx));
+		float corner_y = (hy < box.min_y ? box.min_y : (hy > box.max_y ? box.max_y : hy));
+		if (corner_x != hx && corner_y != hy) {
+			//solve |(x,y) + s (dx,dy) - corner| = radius for the first s:
+			float px = x - corner_x, py = y - corner_y;
+			float a = dx * dx + dy * dy;
+			float b = px * dx + py * dy;
+			float c = px * px + py * py - radius * radius;
+			float discriminant = b * b - a * c;
+			if (a == 0.0f || discriminant < 0.0f) continue;
+			enter = (-b - std::sqrt(discriminant)) / a;
+			if (enter < 0.0f || enter >= best) continue;
+			hit_nx = (px + enter * dx) / radius;
+			hit_ny = (py + enter * dy) / radius;
+		}
+
+		best = enter;
+		*nx = hit_nx;
+		*ny = hit_ny;
+		found = true;
+	}
+	if (found) *t = best;
+	return found;
+}
+
+bool CollisionWorld::move_ball(float &x, float &y, float dx, float dy, float &vel_x, float &vel_y, float radius) const {
+	bool hit = false;
+	//bounce until the whole move is used up; every bounce but a few in a row must make some progress,
+	// so a ball wedged where it can't move (e.g., into a corner tighter than it) stops instead of spinning:
+	float const min_progress = 1e-3f * radius;
+	uint32_t stalled = 0;
+	while (true) {
+		float t, nx, ny;
+		if (!sweep_ball(x, y, dx, dy, radius, &t, &nx, &ny)) {
+			x += dx;
+			y += dy;
+			return hit;
+		}
+		hit = true;
+		x += t * dx;
+		y += t * dy;
+		if (t * std::sqrt(dx * dx + dy * dy) < min_progress) {
+			stalled += 1;
+			if (stalled > 4) return hit; //(the ball is wedged; the rest of the move is dropped)
+		} else {
+			stalled = 0;
+		}
+		//reflect the velocity and the rest of the move off the surface:
+		float into = vel_x * nx + vel_y * ny;
+		if (into < 0.0f) {
+			vel_x -= 2.0f * into * nx;
+			vel_y -= 2.0f * into * ny;
+		}
+		dx *= (1.0f - t);
+		dy *= (1.0f - t);
+		float rest = dx * nx + dy * ny;
+		if (rest < 0.0f) {
+			dx -= 2.0f * rest * nx;
+			dy -= 2.0f * rest * ny;
+		}
+	}
+}
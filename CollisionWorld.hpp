@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//CollisionWorld holds a match's static obstacles (walls and other scenery) as boxes in sim coordinates
+// (see VolleyballSim) and resolves the ball and players against them.
+// Obstacles are bucketed in a uniform grid, so each test only looks at the obstacles in the cells a
+// moving shape overlaps -- the obstacle count can grow without every step testing every obstacle.
+// Like VolleyballSim, it has no SDL or OpenGL dependency.
+struct CollisionWorld {
+	struct Box {
+		float min_x = 0.0f, min_y = 0.0f;
+		float max_x = 0.0f, max_y = 0.0f; //(may be infinite, e.g. for walls that reach up forever)
+	};
+
+	//add an obstacle (call build() before testing against it):
+	void add(Box const &box);
+	//remove all obstacles:
+	void clear();
+	//bucket obstacles into the grid:
+	void build();
+
+	//push a ball out of any obstacles it overlaps, reflecting its velocity off each one it is moving into:
+	// returns true if the ball touched anything.
+	bool collide_ball(float &x, float &y, float &vel_x, float &vel_y, float radius) const;
+
+	//first obstacle hit by a ball of 'radius' moving from (x,y) by (dx,dy), if any:
+	// 't' is the fraction of the move made before touching; (nx,ny) is the obstacle's outward surface normal there.
+	// (obstacles the ball already overlaps at the start are ignored; see collide_ball)
+	bool sweep_ball(float x, float y, float dx, float dy, float radius, float *t, float *nx, float *ny) const;
+
+	//move a ball by (dx,dy), bouncing (reflecting velocity and the rest of the move) off obstacles in its way:
+	// the whole move is made, however far it goes, unless the ball gets wedged (several bounces in a row
+	// with no real progress), in which case it stops where it is. Returns true if the ball hit anything.
+	bool move_ball(float &x, float &y, float dx, float dy, float &vel_x, float &vel_y, float radius) const;
+
+	//push a box (e.g., a player) out of any obstacles it overlaps, along the shallowest axis:
+	// vertical velocity stops on impact; 'landed' is set if the box ended up resting on top of something.
+	bool collide_box(float &x, float &y, float half_x, float half_y, float &vel_y, bool *landed) const;
+
+	//the indices of obstacles whose grid cells overlap [min,max] (each once, in index order):
+	void query(float min_x, float min_y, float max_x, float max_y, std::vector< uint32_t > *candidates) const;
+
+	float cell_size = 2.0f; //grid cell width and height (sim units)
+
+	//internals:
+	std::vector< Box > boxes;
+	//grid covers the finite extent of all boxes; anything beyond lands in the edge cells:
+	float grid_x = 0.0f, grid_y = 0.0f; //lower-left corner
+	uint32_t columns = 0, rows = 0;
+	std::vector< uint32_t > cell_begin; //obstacles in cell c are cell_items[cell_begin[c] .. cell_begin[c+1]]
+	std::vector< uint32_t > cell_items;
+	void cell_range(float min_x, float min_y, float max_x, float max_y, uint32_t *c0, uint32_t *r0, uint32_t *c1, uint32_t *r1) const;
+	//(the scratch state below means a world can't be used from several threads at once)
+	mutable std::vector< uint32_t > scratch; //candidate list reused by collide_*() and sweep_ball()
+	mutable std::vector< uint32_t > stamps; //per obstacle: last query that reported it (dedupes candidates)
+	mutable uint32_t stamp = 0;
+};
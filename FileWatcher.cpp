@@ -0,0 +1,117 @@
+#include "FileWatcher.hpp"
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <iostream>
+
+//modification time and size of a file (or -1s if it can't be examined):
+static void stat_file(std::string const &filename, int64_t *mtime, int64_t *size) {
+	#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(filename.c_str(), &info) != 0) {
+	#else
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+	#endif
+		*mtime = -1;
+		*size = -1;
+		return;
+	}
+	//(nanoseconds where the platform has them, so quick successive writes still differ)
+	#if defined(__linux__)
+	*mtime = int64_t(info.st_mtim.tv_sec) * 1000000000 + int64_t(info.st_mtim.tv_nsec);
+	#elif defined(__APPLE__)
+	*mtime = int64_t(info.st_mtimespec.tv_sec) * 1000000000 + int64_t(info.st_mtimespec.tv_nsec);
+	#else
+	*mtime = int64_t(info.st_mtime);
+	#endif
+	*size = int64_t(info.st_size);
+}
+
+FileWatcher::FileWatcher() {
+	#ifdef __linux__
+	inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify == -1) {
+		std::cerr << "NOTE: inotify not available; watching files by modification time instead." << std::endl;
+	}
+	#endif
+}
+
+FileWatcher::~FileWatcher() {
+	#ifdef __linux__
+	if (inotify != -1) close(inotify);
+	#endif
+}
+
+void FileWatcher::watch(std::string const &filename) {
+	Watched w;
+	w.filename = filename;
+	size_t slash = filename.find_last_of("/\\");
+	if (slash == std::string::npos) {
+		w.name = filename;
+	} else {
+		w.directory = filename.substr(0, slash + 1);
+		w.name = filename.substr(slash + 1);
+	}
+	stat_file(filename, &w.mtime, &w.size);
+
+	#ifdef __linux__
+	if (inotify != -1) {
+		//IN_CLOSE_WRITE: rewritten in place; IN_MOVED_TO: replaced by a rename:
+		w.descriptor = inotify_add_watch(inotify, (w.directory.empty() ? "." : w.directory.c_str()), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (w.descriptor == -1) {
+			std::cerr << "WARNING: can't watch the directory of '" << filename << "'; checking its modification time instead." << std::endl;
+		}
+	}
+	#endif
+
+	watched.emplace_back(w);
+}
+
+std::vector< std::string > FileWatcher::poll() {
+	std::vector< std::string > changed;
+	auto report = [&changed](std::string const &filename) {
+		if (std::find(changed.begin(), changed.end(), filename) == changed.end()) {
+			changed.emplace_back(filename);
+		}
+	};
+
+	#ifdef __linux__
+	if (inotify != -1) {
+		//(the buffer is aligned for inotify_event, as inotify(7) suggests)
+		alignas(inotify_event) char buffer[4096];
+		while (true) {
+			ssize_t length = read(inotify, buffer, sizeof(buffer));
+			if (length <= 0) break; //(EAGAIN: nothing more to read)
+			for (char const *at = buffer; at < buffer + length; ) {
+				inotify_event const *event = reinterpret_cast< inotify_event const * >(at);
+				if (event->len > 0) {
+					for (auto const &w : watched) {
+						if (w.descriptor == event->wd && w.name == event->name) report(w.filename);
+					}
+				}
+				at += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+	#endif
+
+	for (auto &w : watched) {
+		if (w.descriptor != -1) continue;
+		int64_t mtime, size;
+		stat_file(w.filename, &mtime, &size);
+		if (mtime != w.mtime || size != w.size) {
+			w.mtime = mtime;
+			w.size = size;
+			if (mtime != -1) report(w.filename);
+		}
+	}
+
+	return changed;
+}
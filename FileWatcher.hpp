@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//FileWatcher reports which of a set of files have been (re)written since it was last asked:
+// on Linux it uses inotify on each file's directory (so files that are replaced, rather than
+// rewritten in place, are still noticed); elsewhere -- or if inotify isn't available -- it
+// compares modification times on every poll().
+struct FileWatcher {
+	FileWatcher();
+	~FileWatcher();
+	FileWatcher(FileWatcher const &) = delete;
+	FileWatcher &operator=(FileWatcher const &) = delete;
+
+	void watch(std::string const &filename);
+
+	//files written since the last call (each listed once; never blocks):
+	std::vector< std::string > poll();
+
+	//internals:
+	struct Watched {
+		std::string filename;
+		std::string directory; //(with trailing separator, or empty for the working directory)
+		std::string name; //within 'directory'
+		//(used when comparing modification times; size too, since on some platforms mtime has one-second resolution):
+		int64_t mtime = -1;
+		int64_t size = -1;
+		int descriptor = -1; //inotify watch on 'directory'
+	};
+	std::vector< Watched > watched;
+	int inotify = -1; //inotify instance, or -1 if comparing modification times
+};
@@ -0,0 +1,112 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//read a whole file into 'bytes' (for Access::Read):
+static void read_file(std::string const &filename, std::vector< uint8_t > *bytes) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	if (size < 0) {
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	bytes->resize(size_t(size));
+	if (!bytes->empty() && !file.read(reinterpret_cast< char * >(bytes->data()), bytes->size())) {
+		throw std::runtime_error("Failed to read '" + filename + "' (was it truncated while reading?).");
+	}
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const &filename, Access access) {
+	if (access == Read) {
+		read_file(filename, &bytes);
+		data = (bytes.empty() ? nullptr : bytes.data());
+		size = bytes.size();
+		return;
+	}
+	HANDLE f = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (f == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	file = f;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(f, &file_size)) {
+		CloseHandle(f);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //(empty files can't be mapped, but there is nothing to see anyway)
+
+	mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) {
+		data = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!data) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(f);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (data && bytes.empty()) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename, Access access) {
+	if (access == Read) {
+		read_file(filename, &bytes);
+		data = (bytes.empty() ? nullptr : bytes.data());
+		size = bytes.size();
+		return;
+	}
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(st.st_size);
+	if (size == 0) { //(empty files can't be mapped, but there is nothing to see anyway)
+		close(fd);
+		return;
+	}
+
+	void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //(the mapping keeps its own reference to the file)
+	if (ptr == MAP_FAILED) {
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	//chunks are read front-to-back:
+	madvise(ptr, size, MADV_SEQUENTIAL);
+	data = reinterpret_cast< uint8_t const * >(ptr);
+}
+
+MappedFile::~MappedFile() {
+	if (data && bytes.empty()) munmap(const_cast< uint8_t * >(data), size);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//MappedFile maps a whole file read-only into memory (mmap / CreateFileMapping),
+// so loaders can look at its bytes in place instead of reading them into buffers:
+// note: throws if the file can't be opened or mapped.
+struct MappedFile {
+	enum Access {
+		Map, //look at the file's pages directly
+		//read the file into memory owned by this object instead; use this if the file may be rewritten
+		// while its bytes are still in use (on POSIX, touching a mapped page of a file truncated
+		// underneath the mapping raises SIGBUS):
+		Read,
+	};
+	explicit MappedFile(std::string const &filename, Access access = Map);
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+	~MappedFile();
+
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+
+	//internals:
+	std::vector< uint8_t > bytes; //file contents, when read with Access::Read
+	#ifdef _WIN32
+	void *file = nullptr; //HANDLEs
+	void *mapping = nullptr;
+	#endif
+};
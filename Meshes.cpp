@@ -1,94 +1,505 @@
 #include "Meshes.hpp"
 #include "read_chunk.hpp"
+#include "MappedFile.hpp"
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 
-void Meshes::load(std::string const &filename, Attributes const &attributes) {
-	std::ifstream file(filename, std::ios::binary);
+//vertex formats:
+struct v3n3 {
+	glm::vec3 v;
+	glm::vec3 n;
+};
+static_assert(sizeof(v3n3) == 24, "v3n3 is packed");
+struct q3n1 {
+	int16_t v[4]; //position, normalized to the mesh's bounding box ([-1,1] spans min..max); v[3] unused
+	uint32_t n; //normal, as GL_INT_2_10_10_10_REV
+};
+static_assert(sizeof(q3n1) == 12, "q3n1 is packed");
 
-	GLuint vao = 0;
-	GLuint total = 0;
-	{ //read + upload data chunk:
-		struct v3n3 {
-			glm::vec3 v;
-			glm::vec3 n;
-		};
-		static_assert(sizeof(v3n3) == 24, "v3n3 is packed");
-		std::vector< v3n3 > data;
-		read_chunk(file, "v3n3", &data);
-
-		//upload data:
-		GLuint buffer = 0;
-		glGenBuffers(1, &buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(v3n3) * data.size(), &data[0], GL_STATIC_DRAW);
-
-		total = data.size(); //store total for later checks on index
-
-		//store binding:
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
-		if (attributes.Position != -1U) {
-			glVertexAttribPointer(attributes.Position, 3, GL_FLOAT, GL_FALSE, sizeof(v3n3), (GLbyte *)0);
-			glEnableVertexAttribArray(attributes.Position);
+//throw unless elements [start,start+count) exist and all refer to one of 'vertex_count' vertices:
+template< typename T >
+static void check_elements(ChunkSpan< T > const &elements, uint32_t start, uint32_t count, uint32_t vertex_count) {
+	if (!(start <= elements.size() && count <= elements.size() - start)) {
+		throw std::runtime_error("index entry has out-of-range index start/count");
+	}
+	for (uint32_t i = start; i < start + count; ++i) {
+		if (elements[i] >= vertex_count) {
+			throw std::runtime_error("mesh has out-of-range vertex index");
+		}
+	}
+}
+
+//where a part's indices are in a parsed file (16-bit indices come first, then 32-bit ones from 'offset32'):
+static uint8_t const *element_data(Meshes::Parsed const &parsed, Meshes::Part const &part) {
+	if (part.element_begin < parsed.offset32) {
+		return parsed.elements16 + part.element_begin;
+	} else {
+		return parsed.elements32 + (part.element_begin - parsed.offset32);
+	}
+}
+
+//(re)point an arena's vertex array at its current buffers:
+static void bind_arena(Meshes::Arena const &arena) {
+	glBindVertexArray(arena.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, arena.vertex_buffer);
+	bool quantized = (arena.format == "q3n1");
+	if (arena.attributes.Position != -1U) {
+		if (quantized) {
+			glVertexAttribPointer(arena.attributes.Position, 3, GL_SHORT, GL_TRUE, sizeof(q3n1), (GLbyte *)0);
 		} else {
-			std::cerr << "WARNING: loading v3n3 data from '" << filename << "', but not using the Position attribute." << std::endl;
+			glVertexAttribPointer(arena.attributes.Position, 3, GL_FLOAT, GL_FALSE, sizeof(v3n3), (GLbyte *)0);
 		}
-		if (attributes.Normal != -1U) {
-			glVertexAttribPointer(attributes.Normal, 3, GL_FLOAT, GL_FALSE, sizeof(v3n3), (GLbyte *)0 + sizeof(glm::vec3));
-			glEnableVertexAttribArray(attributes.Normal);
+		glEnableVertexAttribArray(arena.attributes.Position);
+	}
+	if (arena.attributes.Normal != -1U) {
+		if (quantized) {
+			glVertexAttribPointer(arena.attributes.Normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(q3n1), (GLbyte *)0 + offsetof(q3n1, n));
 		} else {
-			std::cerr << "WARNING: loading v3n3 data from '" << filename << "', but not using the Normal attribute." << std::endl;
+			glVertexAttribPointer(arena.attributes.Normal, 3, GL_FLOAT, GL_FALSE, sizeof(v3n3), (GLbyte *)0 + sizeof(glm::vec3));
 		}
+		glEnableVertexAttribArray(arena.attributes.Normal);
+	}
+	//(element array binding is part of the vertex array's state)
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.element_buffer);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//copy ranges (src offset, dst offset, size) of 'from' into a new buffer of 'capacity' bytes; deletes 'from':
+static GLuint copy_to_new_buffer(GLuint from, size_t capacity, std::vector< std::array< size_t, 3 > > const &ranges) {
+	GLuint to = 0;
+	glGenBuffers(1, &to);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+	glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+	if (from != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, from);
+		for (auto const &range : ranges) {
+			if (range[2] == 0) continue;
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range[0], range[1], range[2]);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &from);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return to;
+}
+
+void Meshes::reserve(Arena &arena, size_t vertex_bytes, size_t element_bytes) {
+	bool moved = false;
+	if (arena.vertex_used + vertex_bytes > arena.vertex_capacity) {
+		arena.vertex_capacity = std::max(arena.vertex_used + vertex_bytes, 2 * arena.vertex_capacity);
+		arena.vertex_buffer = copy_to_new_buffer(arena.vertex_buffer, arena.vertex_capacity, {{{0, 0, arena.vertex_used}}});
+		moved = true;
+	}
+	if (arena.element_used + element_bytes > arena.element_capacity) {
+		arena.element_capacity = std::max(arena.element_used + element_bytes, 2 * arena.element_capacity);
+		arena.element_buffer = copy_to_new_buffer(arena.element_buffer, arena.element_capacity, {{{0, 0, arena.element_used}}});
+		moved = true;
+	}
+	if (moved) bind_arena(arena);
+}
+
+void Meshes::compact(size_t arena_index) {
+	Arena &arena = arenas[arena_index];
+	std::vector< std::array< size_t, 3 > > vertex_ranges, element_ranges;
+	size_t vertex_used = 0;
+	size_t element_used = 0;
+	for (auto &blob : blobs) {
+		if (blob.arena != arena_index) continue;
+		vertex_ranges.push_back({{blob.vertex_offset, vertex_used, blob.vertex_bytes}});
+		element_ranges.push_back({{blob.element_offset, element_used, blob.element_bytes}});
+
+		//shift this blob's meshes to match:
+		size_t stride = (arena.format == "q3n1" ? sizeof(q3n1) : sizeof(v3n3));
+		GLint vertex_shift = GLint(vertex_used / stride) - GLint(blob.vertex_offset / stride);
+		GLint element_shift = GLint(element_used) - GLint(blob.element_offset); //(bytes; multiple of 4)
+		for (auto const &name : blob.names) {
+			Mesh &mesh = *meshes.find(name);
+			if (mesh.index_type) {
+				mesh.base_vertex += vertex_shift;
+				mesh.start += element_shift / (mesh.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+			} else {
+				mesh.start += vertex_shift;
+			}
+		}
+
+		blob.vertex_offset = vertex_used;
+		blob.element_offset = element_used;
+		vertex_used += blob.vertex_bytes;
+		element_used += (blob.element_bytes + 3) / 4 * 4;
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	if (vertex_used == arena.vertex_used && element_used == arena.element_used) return; //no gaps
 
-	{ //read index chunk, add to meshes:
+	//(copying within one buffer isn't allowed to overlap, so copy into fresh buffers instead)
+	arena.vertex_buffer = copy_to_new_buffer(arena.vertex_buffer, arena.vertex_capacity, vertex_ranges);
+	arena.element_buffer = copy_to_new_buffer(arena.element_buffer, arena.element_capacity, element_ranges);
+	arena.vertex_used = vertex_used;
+	arena.element_used = element_used;
+	bind_arena(arena);
+	revision += 1;
+}
+
+void Meshes::load(std::string const &filename, Attributes const &attributes) {
+	upload(parse(filename), attributes);
+}
+
+Meshes::Parsed Meshes::parse(std::string const &filename, MappedFile::Access access) {
+	Parsed parsed;
+	parsed.filename = filename;
+
+	//chunks are used in place, straight out of the mapped (or read) file:
+	parsed.file = std::make_shared< MappedFile >(filename, access);
+	ChunkReader reader(parsed.file->data, parsed.file->size);
+
+	//read (but don't upload yet) vertex data:
+	bool quantized = reader.has("q3n1");
+	parsed.format = (quantized ? "q3n1" : "v3n3");
+	ChunkSpan< v3n3 > data; //(only for unquantized blobs)
+	ChunkSpan< q3n1 > packed; //(only for quantized blobs)
+	GLuint total = 0;
+	if (quantized) {
+		reader.read("q3n1", &packed);
+		parsed.vertex_bytes = packed.bytes;
+		parsed.vertex_size = packed.size_bytes();
+		total = packed.size(); //store total for later checks on index
+	} else {
+		reader.read("v3n3", &data);
+		parsed.vertex_bytes = data.bytes;
+		parsed.vertex_size = data.size_bytes();
+		total = data.size();
+	}
+	size_t stride = (quantized ? sizeof(q3n1) : sizeof(v3n3));
+
+	//per-mesh bounding boxes (one per index entry); required for quantized data, otherwise computed if missing:
+	struct Bounds {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+	static_assert(sizeof(Bounds) == 24, "Bounds is packed");
+	ChunkSpan< Bounds > bounds;
+	if (reader.has("bnd0")) {
+		reader.read("bnd0", &bounds);
+	} else if (quantized) {
+		throw std::runtime_error("quantized mesh data in '" + filename + "' without bounds");
+	}
+
+	//fill in bounds and dequantization for the mesh at 'entry' in the index:
+	auto set_bounds = [&](Mesh &mesh, size_t entry, uint32_t vertex_start, uint32_t vertex_count) {
+		if (!bounds.empty()) {
+			if (entry >= bounds.size()) throw std::runtime_error("index entry has no bounds");
+			Bounds b = bounds[entry];
+			mesh.min = b.min;
+			mesh.max = b.max;
+		} else {
+			mesh.min = glm::vec3(std::numeric_limits< float >::infinity());
+			mesh.max = glm::vec3(-std::numeric_limits< float >::infinity());
+			for (uint32_t i = vertex_start; i < vertex_start + vertex_count; ++i) {
+				glm::vec3 v = data[i].v;
+				mesh.min = glm::min(mesh.min, v);
+				mesh.max = glm::max(mesh.max, v);
+			}
+		}
+		if (quantized) {
+			glm::vec3 center = 0.5f * (mesh.max + mesh.min);
+			glm::vec3 radius = 0.5f * (mesh.max - mesh.min);
+			mesh.dequantize = glm::mat4(
+				glm::vec4(radius.x, 0.0f, 0.0f, 0.0f),
+				glm::vec4(0.0f, radius.y, 0.0f, 0.0f),
+				glm::vec4(0.0f, 0.0f, radius.z, 0.0f),
+				glm::vec4(center, 1.0f)
+			);
+		}
+	};
+
+	ChunkSpan< char > strings;
+	reader.read("str0", &strings);
+
+	ChunkSpan< uint16_t > elements16;
+	ChunkSpan< uint32_t > elements32;
+
+	if (reader.has("idx1")) { //indexed meshes:
+		reader.read("ix16", &elements16);
+		reader.read("ix32", &elements32);
+		parsed.elements16 = elements16.bytes;
+		parsed.elements16_size = elements16.size_bytes();
+		parsed.elements32 = elements32.bytes;
+		parsed.elements32_size = elements32.size_bytes();
+		//(32-bit indices go after the 16-bit ones, suitably aligned)
+		parsed.offset32 = (elements16.size_bytes() + 3) / 4 * 4;
+
+		struct IndexEntry {
+			uint32_t name_begin, name_end;
+			uint32_t vertex_start, vertex_count;
+			uint32_t index_start, index_count; //(in ix16 or ix32, depending on index_bits)
+			uint32_t index_bits;
+			uint32_t name_hash; //NameID of the name (or zero if not stored)
+		};
+		static_assert(sizeof(IndexEntry) == 32, "Index entry should be packed");
+
+		ChunkSpan< IndexEntry > index;
+		reader.read("idx1", &index);
+
+		for (size_t i = 0; i < index.size(); ++i) {
+			IndexEntry entry = index[i];
+			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+				throw std::runtime_error("index entry has out-of-range name begin/end");
+			}
+			if (!(entry.vertex_start < entry.vertex_start + entry.vertex_count && entry.vertex_start + entry.vertex_count <= total)) {
+				throw std::runtime_error("index entry has out-of-range vertex start/count");
+			}
+			std::string name(strings.bytes + entry.name_begin, strings.bytes + entry.name_end);
+			NameID id(name);
+			if (entry.name_hash != 0 && NameID::from_hash(entry.name_hash) != id) {
+				throw std::runtime_error("index entry for '" + name + "' has a stored name hash that doesn't match its name");
+			}
+			Mesh mesh;
+			mesh.count = entry.index_count;
+			mesh.base_vertex = entry.vertex_start;
+			set_bounds(mesh, i, entry.vertex_start, entry.vertex_count);
+			if (entry.index_bits == 16) {
+				check_elements(elements16, entry.index_start, entry.index_count, entry.vertex_count);
+				mesh.index_type = GL_UNSIGNED_SHORT;
+				mesh.start = entry.index_start;
+			} else if (entry.index_bits == 32) {
+				check_elements(elements32, entry.index_start, entry.index_count, entry.vertex_count);
+				mesh.index_type = GL_UNSIGNED_INT;
+				mesh.start = GLuint(parsed.offset32 / 4) + entry.index_start;
+			} else {
+				throw std::runtime_error("index entry has unsupported index size");
+			}
+			Part part;
+			part.vertex_begin = size_t(entry.vertex_start) * stride;
+			part.vertex_end = size_t(entry.vertex_start + entry.vertex_count) * stride;
+			part.element_begin = size_t(mesh.start) * (entry.index_bits / 8);
+			part.element_end = part.element_begin + size_t(entry.index_count) * (entry.index_bits / 8);
+			parsed.entries.emplace_back(Parsed::Entry{id, name, mesh, part});
+		}
+	} else { //unindexed meshes (older blobs):
+		//read index chunk, add to meshes:
 		struct IndexEntry {
 			uint32_t name_begin, name_end;
 			uint32_t vertex_start, vertex_count;
 		};
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
-		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		ChunkSpan< IndexEntry > index;
+		reader.read("idx0", &index);
 
-		for (auto const &entry : index) {
+		for (size_t i = 0; i < index.size(); ++i) {
+			IndexEntry entry = index[i];
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
 			if (!(entry.vertex_start < entry.vertex_start + entry.vertex_count && entry.vertex_start + entry.vertex_count <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			std::string name(strings.bytes + entry.name_begin, strings.bytes + entry.name_end);
 			Mesh mesh;
-			mesh.vao = vao;
 			mesh.start = entry.vertex_start;
 			mesh.count = entry.vertex_count;
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
-			}
+			set_bounds(mesh, i, entry.vertex_start, entry.vertex_count);
+			Part part;
+			part.vertex_begin = size_t(entry.vertex_start) * stride;
+			part.vertex_end = size_t(entry.vertex_start + entry.vertex_count) * stride;
+			parsed.entries.emplace_back(Parsed::Entry{NameID(name), name, mesh, part});
 		}
 	}
 
-	if (file.peek() != EOF) {
+	if (!reader.at_end()) {
 		std::cerr << "WARNING: trailing data in mesh file '" + filename + "'" << std::endl;
 	}
+
+	//checksum each mesh's data (so reload() can tell which meshes changed):
+	for (auto &entry : parsed.entries) {
+		Part &part = entry.part;
+		uint32_t vertex_checksum = blob_checksum(parsed.vertex_bytes + part.vertex_begin, part.vertex_end - part.vertex_begin);
+		uint32_t element_checksum = 0;
+		if (part.element_end != part.element_begin) {
+			element_checksum = blob_checksum(element_data(parsed, part), part.element_end - part.element_begin);
+		}
+		part.checksum = vertex_checksum ^ (element_checksum * 0x01000193);
+	}
+
+	//meshes are looked up by hash alone, so two names with the same hash can't both be loaded:
+	NameTable< bool > seen;
+	for (auto const &entry : parsed.entries) {
+		if (seen.collides(entry.id, entry.name)) {
+			throw std::runtime_error("mesh name '" + entry.name + "' in '" + filename + "' has the same hash as another name in the file");
+		}
+		seen.insert(entry.id, entry.name, true);
+	}
+
+	return parsed;
+}
+
+//throw if any of 'parsed''s mesh names has the same hash as a different loaded name
+// (other than those in 'replacing', which are about to be unloaded):
+static void check_name_hashes(NameTable< Mesh > const &meshes, Meshes::Parsed const &parsed, std::vector< NameID > const &replacing) {
+	for (auto const &entry : parsed.entries) {
+		if (std::find(replacing.begin(), replacing.end(), entry.id) != replacing.end()) continue;
+		if (meshes.collides(entry.id, entry.name)) {
+			throw std::runtime_error("mesh name '" + entry.name + "' in '" + parsed.filename + "' has the same hash as an already-loaded mesh's name");
+		}
+	}
+}
+
+void Meshes::upload(Parsed const &parsed, Attributes const &attributes) {
+	std::string const &filename = parsed.filename;
+	for (auto const &blob : blobs) {
+		if (blob.filename == filename) throw std::runtime_error("'" + filename + "' is already loaded.");
+	}
+	check_name_hashes(meshes, parsed, std::vector< NameID >());
+	if (attributes.Position == -1U) {
+		std::cerr << "WARNING: loading " << parsed.format << " data from '" << filename << "', but not using the Position attribute." << std::endl;
+	}
+	if (attributes.Normal == -1U) {
+		std::cerr << "WARNING: loading " << parsed.format << " data from '" << filename << "', but not using the Normal attribute." << std::endl;
+	}
+
+	//find (or make) an arena for this vertex format:
+	size_t arena_index = 0;
+	while (arena_index < arenas.size() && !(arenas[arena_index].format == parsed.format && arenas[arena_index].attributes == attributes)) {
+		++arena_index;
+	}
+	if (arena_index == arenas.size()) {
+		arenas.emplace_back();
+		arenas.back().format = parsed.format;
+		arenas.back().attributes = attributes;
+		glGenVertexArrays(1, &arenas.back().vao);
+	}
+	Arena &arena = arenas[arena_index];
+
+	//upload data (directly from the mapping) to the end of the arena:
+	size_t vertex_size = parsed.vertex_size;
+	size_t element_size = parsed.offset32 + parsed.elements32_size;
+	reserve(arena, vertex_size, element_size);
+
+	Blob blob;
+	blob.filename = filename;
+	blob.arena = arena_index;
+	blob.vertex_offset = arena.vertex_used;
+	blob.vertex_bytes = vertex_size;
+	blob.element_offset = arena.element_used;
+	blob.element_bytes = element_size;
+
+	glBindBuffer(GL_ARRAY_BUFFER, arena.vertex_buffer);
+	if (vertex_size) glBufferSubData(GL_ARRAY_BUFFER, blob.vertex_offset, vertex_size, parsed.vertex_bytes);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//(bind via the vertex array so the element binding stays where it belongs)
+	glBindVertexArray(arena.vao);
+	if (parsed.elements16_size) glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, blob.element_offset, parsed.elements16_size, parsed.elements16);
+	if (parsed.elements32_size) glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, blob.element_offset + parsed.offset32, parsed.elements32_size, parsed.elements32);
+	glBindVertexArray(0);
+
+	arena.vertex_used += vertex_size;
+	arena.element_used += (element_size + 3) / 4 * 4;
+
+	//add meshes, shifted to where this file's data landed:
+	GLint vertex_shift = GLint(blob.vertex_offset / (parsed.format == "q3n1" ? sizeof(q3n1) : sizeof(v3n3)));
+	GLuint element_offset = GLuint(blob.element_offset);
+	for (auto const &l : parsed.entries) {
+		Mesh mesh = l.mesh;
+		mesh.vao = arena.vao;
+		if (mesh.index_type) {
+			mesh.base_vertex += vertex_shift;
+			mesh.start += element_offset / (mesh.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+		} else {
+			mesh.start += vertex_shift;
+		}
+		bool inserted = meshes.insert(l.id, l.name, mesh).second;
+		if (!inserted) {
+			std::cerr << "WARNING: mesh name '" + l.name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+		} else {
+			blob.names.emplace_back(l.id);
+			blob.parts.emplace_back(l.part);
+		}
+	}
+	blobs.emplace_back(blob);
+}
+
+size_t Meshes::reload(Parsed const &parsed, Attributes const &attributes) {
+	auto blob = std::find_if(blobs.begin(), blobs.end(), [&parsed](Blob const &b) { return b.filename == parsed.filename; });
+	if (blob == blobs.end()) {
+		upload(parsed, attributes);
+		return parsed.entries.size();
+	}
+	Arena &arena = arenas[blob->arena];
+
+	//can the new version be written over the old one?
+	bool same_layout = (arena.format == parsed.format && arena.attributes == attributes
+		&& blob->vertex_bytes == parsed.vertex_size
+		&& blob->element_bytes == parsed.offset32 + parsed.elements32_size
+		&& blob->names.size() == parsed.entries.size());
+	for (size_t i = 0; same_layout && i < parsed.entries.size(); ++i) {
+		same_layout = (blob->names[i] == parsed.entries[i].id && blob->parts[i].same_place(parsed.entries[i].part));
+	}
+	if (!same_layout) {
+		check_name_hashes(meshes, parsed, blob->names); //(before unloading, so a bad file leaves the old one in place)
+		unload(parsed.filename);
+		upload(parsed, attributes);
+		return parsed.entries.size();
+	}
+
+	//same layout: re-upload just the meshes whose data changed:
+	size_t changed = 0;
+	bool bounds_changed = false;
+	for (size_t i = 0; i < parsed.entries.size(); ++i) {
+		Parsed::Entry const &entry = parsed.entries[i];
+		Part &part = blob->parts[i];
+		Mesh &mesh = *meshes.find(entry.id);
+		//(bounds may move without the data changing, for quantized meshes; stored positions are relative to them)
+		if (mesh.min != entry.mesh.min || mesh.max != entry.mesh.max || mesh.dequantize != entry.mesh.dequantize) {
+			bounds_changed = true;
+		}
+		mesh.min = entry.mesh.min;
+		mesh.max = entry.mesh.max;
+		mesh.dequantize = entry.mesh.dequantize;
+		if (part.checksum == entry.part.checksum) continue;
+		part.checksum = entry.part.checksum;
+		changed += 1;
+
+		glBindBuffer(GL_ARRAY_BUFFER, arena.vertex_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, blob->vertex_offset + part.vertex_begin, part.vertex_end - part.vertex_begin, parsed.vertex_bytes + part.vertex_begin);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (part.element_end != part.element_begin) {
+			glBindVertexArray(arena.vao);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, blob->element_offset + part.element_begin, part.element_end - part.element_begin, element_data(parsed, part));
+			glBindVertexArray(0);
+		}
+	}
+	//(a re-export that changed nothing leaves Mesh copies valid)
+	if (changed > 0 || bounds_changed) revision += 1;
+	return changed;
+}
+
+void Meshes::unload(std::string const &filename) {
+	auto blob = std::find_if(blobs.begin(), blobs.end(), [&filename](Blob const &b) { return b.filename == filename; });
+	if (blob == blobs.end()) {
+		throw std::runtime_error("Unloading '" + filename + "', which isn't loaded.");
+	}
+	for (auto const &name : blob->names) {
+		meshes.erase(name);
+	}
+	size_t arena = blob->arena;
+	blobs.erase(blob);
+	revision += 1;
+	compact(arena);
 }
 
-Mesh const &Meshes::get(std::string const &name) const {
-	auto f = meshes.find(name);
-	if (f == meshes.end()) {
+Mesh const &Meshes::get(NameID name) const {
+	Mesh const *mesh = meshes.find(name);
+	if (!mesh) {
 		throw std::runtime_error("Looking up mesh that doesn't exist.");
 	}
-	return f->second;
+	return *mesh;
 }
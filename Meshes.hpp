@@ -1,31 +1,140 @@
 #pragma once
 
 #include "GL.hpp"
-#include <map>
+#include "MappedFile.hpp"
+#include "NameTable.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
 
 //Mesh is a lightweight handle to some OpenGL vertex data:
 struct Mesh {
 	GLuint vao = 0;
-	GLuint start = 0;
-	GLuint count = 0;
+	GLuint start = 0; //first vertex (or, for indexed meshes, first index in the vao's element buffer)
+	GLuint count = 0; //vertex (or index) count
+	GLenum index_type = 0; //GL_UNSIGNED_SHORT / GL_UNSIGNED_INT for indexed meshes, 0 otherwise
+	GLint base_vertex = 0; //added to every index
+	//object-space bounding box:
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+	//maps vertex positions into object space (identity unless positions are quantized to the bounding box):
+	glm::mat4 dequantize = glm::mat4(1.0f);
 };
 
 //"Meshes" loads a collection of meshes and builds VAOs for 'em
 // you pass in a 'Bindings' object to specify which attributes to bind where
 
+//Vertex data comes as 'v3n3' (float position + normal) or, if the blob has it, the packed 'q3n1'
+// (16-bit normalized position within the mesh's bounds + GL_INT_2_10_10_10_REV normal); attribute
+// pointers are set up to match, so shaders see a vec4 position (in [-1,1] for quantized meshes) and a vec3 normal.
+
+//Every blob with the same vertex format (and attribute locations) is suballocated from one shared
+// "arena" -- a growable vertex buffer + element buffer with a single VAO -- so meshes from different
+// files can be drawn without switching vertex arrays.
+
+//Loading is split in two: parse() reads and checks a file without touching OpenGL (so it can run on
+// a loader thread; see AssetLoader), and upload() -- which must run on the thread with the GL context --
+// copies the parsed data into an arena.
+
 struct Meshes {
 	struct Attributes {
 		GLuint Position = -1U;
 		GLuint Normal = -1U;
+		bool operator==(Attributes const &o) const { return Position == o.Position && Normal == o.Normal; }
 	};
 	//add meshes from a file; use the indicated indices for attribute locations:
 	// note: will throw if file fails to read.
 	void load(std::string const &filename, Attributes const &attributes);
 
-	//look up a particular mesh in the DB:
+	//where one mesh's data sits in its file's vertex / element data (in bytes), and a checksum of that data:
+	struct Part {
+		size_t vertex_begin = 0, vertex_end = 0;
+		size_t element_begin = 0, element_end = 0;
+		uint32_t checksum = 0;
+		bool same_place(Part const &o) const {
+			return vertex_begin == o.vertex_begin && vertex_end == o.vertex_end && element_begin == o.element_begin && element_end == o.element_end;
+		}
+	};
+
+	//a mesh file that has been read and checked, but not uploaded:
+	struct Parsed {
+		std::string filename;
+		std::string format; //"v3n3" or "q3n1"
+		std::shared_ptr< MappedFile > file; //(the data pointers below point into this)
+		uint8_t const *vertex_bytes = nullptr;
+		size_t vertex_size = 0;
+		uint8_t const *elements16 = nullptr; //16-bit indices, at the start of the file's element data
+		size_t elements16_size = 0;
+		uint8_t const *elements32 = nullptr; //32-bit indices, at 'offset32' in the file's element data
+		size_t elements32_size = 0;
+		size_t offset32 = 0;
+		struct Entry {
+			NameID id;
+			std::string name;
+			Mesh mesh; //(positions relative to this file's own vertex / element data)
+			Part part;
+		};
+		std::vector< Entry > entries;
+	};
+	//read and check a mesh file (thread-safe; doesn't use OpenGL):
+	// the result looks at the file through 'access' (see MappedFile) -- use MappedFile::Read if the
+	// file might be rewritten before the result is done with.
+	// note: will throw if file fails to read.
+	static Parsed parse(std::string const &filename, MappedFile::Access access = MappedFile::Map);
+	//add the meshes from a parsed file:
+	// note: will throw if a file of the same name is already loaded, or if one of its mesh names has the
+	//  same hash as a different, already-loaded one (in which case nothing is added).
+	void upload(Parsed const &parsed, Attributes const &attributes);
+
+	//bring the meshes from an already-loaded file up to date with a new version of it:
+	// if the file's layout is unchanged, only meshes whose data changed are re-uploaded (in place);
+	// otherwise the old version is unloaded and the new one uploaded (see 'revision').
+	// (a file that isn't loaded yet is just uploaded)
+	// returns the number of meshes that were (re-)uploaded.
+	size_t reload(Parsed const &parsed, Attributes const &attributes);
+
+	//remove the meshes loaded from a file and compact what's left in its arena:
+	// note: this moves other meshes, so Mesh values copied out before the call are stale (see 'revision').
+	// note: will throw if the file isn't loaded.
+	void unload(std::string const &filename);
+
+	//look up a particular mesh in the DB (by name, or -- cheaper -- by a precomputed NameID):
 	// note: will throw if mesh not found.
-	Mesh const &get(std::string const &name) const;
+	// note: the reference is only good until the next upload(), reload(), or unload() (which may
+	//  rehash the table); copy the Mesh to keep it any longer.
+	Mesh const &get(NameID name) const;
+
+	//bumped whenever meshes move, go away, or change (not by a reload that changed nothing):
+	uint32_t revision = 0;
 
 	//internals:
-	std::map< std::string, Mesh > meshes;
+	NameTable< Mesh > meshes;
+
+	struct Arena {
+		std::string format; //"v3n3" or "q3n1"
+		Attributes attributes;
+		GLuint vao = 0;
+		GLuint vertex_buffer = 0;
+		size_t vertex_capacity = 0, vertex_used = 0; //(bytes)
+		GLuint element_buffer = 0;
+		size_t element_capacity = 0, element_used = 0; //(bytes)
+	};
+	std::vector< Arena > arenas;
+
+	//which part of which arena each loaded file occupies:
+	struct Blob {
+		std::string filename;
+		size_t arena = 0;
+		size_t vertex_offset = 0, vertex_bytes = 0;
+		size_t element_offset = 0, element_bytes = 0; //(offset is a multiple of 4)
+		std::vector< NameID > names; //meshes added from this file
+		std::vector< Part > parts; //(parallel to 'names')
+	};
+	std::vector< Blob > blobs; //in arena order
+
+	//make room for at least this many more bytes in an arena (moving its data to larger buffers if needed):
+	void reserve(Arena &arena, size_t vertex_bytes, size_t element_bytes);
+	//squeeze out gaps left by unloaded blobs:
+	void compact(size_t arena);
 };
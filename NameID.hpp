@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//NameID is a name reduced to its 32-bit FNV-1a hash.
+// IDs for string literals are computed at compile time, so code like
+//   if (id == NameID("Sphere")) ...
+// compares integers instead of strings; exporters can also store hashes next to names.
+// (NameTable checks for two different names hashing to the same ID.)
+struct NameID {
+	static constexpr uint32_t Basis = 0x811c9dc5u;
+	static constexpr uint32_t Prime = 0x01000193u;
+
+	//compile-time hash (recursive, as C++11 constexpr functions must be):
+	static constexpr uint32_t hash_literal(char const *str, size_t length, uint32_t h = Basis) {
+		return length == 0 ? h : hash_literal(str + 1, length - 1, (h ^ uint32_t(uint8_t(*str))) * Prime);
+	}
+	//run-time hash (same result):
+	static uint32_t hash_string(char const *str, size_t length) {
+		uint32_t h = Basis;
+		for (size_t i = 0; i < length; ++i) {
+			h = (h ^ uint32_t(uint8_t(str[i]))) * Prime;
+		}
+		return h;
+	}
+
+	constexpr NameID() { }
+	//from a string literal:
+	template< size_t N >
+	constexpr NameID(char const (&str)[N]) : hash(hash_literal(str, N - 1)) { }
+	NameID(char const *str, size_t length) : hash(hash_string(str, length)) { }
+	NameID(std::string const &str) : hash(hash_string(str.data(), str.size())) { }
+
+	static constexpr NameID from_hash(uint32_t hash) { return NameID(hash, 0); }
+
+	constexpr bool operator==(NameID const &o) const { return hash == o.hash; }
+	constexpr bool operator!=(NameID const &o) const { return hash != o.hash; }
+
+	uint32_t hash = Basis; //(hash of the empty string)
+
+private:
+	constexpr NameID(uint32_t hash_, int) : hash(hash_) { }
+};
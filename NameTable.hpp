@@ -0,0 +1,117 @@
+#pragma once
+
+#include "NameID.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//NameTable maps NameIDs to values with open addressing (linear probing) in one flat array,
+// so a lookup is a hash-indexed probe over contiguous slots rather than a walk of string compares.
+// Names are kept alongside values so that two names with the same hash are caught on insert.
+// note: lookups go by ID alone, so looking up a name that isn't in the table finds nothing -- unless
+//  its hash happens to match a stored name; callers that can't rule that out should check collides().
+// note: values live in the slot array, so pointers from find() / insert() are invalidated by any
+//  insert() (which may grow and rehash the array) and any erase() (which shifts entries back).
+template< typename T >
+struct NameTable {
+	struct Slot {
+		bool used = false;
+		NameID id;
+		std::string name;
+		T value;
+	};
+
+	//nullptr if not present:
+	T *find(NameID id) {
+		if (slots.empty()) return nullptr;
+		for (size_t i = id.hash & mask(); slots[i].used; i = (i + 1) & mask()) {
+			if (slots[i].id == id) return &slots[i].value;
+		}
+		return nullptr;
+	}
+	T const *find(NameID id) const {
+		return const_cast< NameTable * >(this)->find(id);
+	}
+
+	//is a *different* name than 'name' stored under 'id'?
+	bool collides(NameID id, std::string const &name) const {
+		if (slots.empty()) return false;
+		for (size_t i = id.hash & mask(); slots[i].used; i = (i + 1) & mask()) {
+			if (slots[i].id == id) return slots[i].name != name;
+		}
+		return false;
+	}
+
+	//add 'value' under 'name' unless something is already there;
+	// returns the stored value and whether it was inserted.
+	// note: throws if a *different* name already has the same ID.
+	std::pair< T *, bool > insert(std::string const &name, T const &value) {
+		return insert(NameID(name), name, value);
+	}
+	//(same, with the name's ID already known -- e.g., stored by an exporter)
+	std::pair< T *, bool > insert(NameID id, std::string const &name, T const &value) {
+		assert(id == NameID(name));
+		if ((count + 1) * 10 > slots.size() * 7) {
+			rehash(slots.empty() ? 16 : 2 * slots.size());
+		}
+		size_t i = id.hash & mask();
+		for (; slots[i].used; i = (i + 1) & mask()) {
+			if (slots[i].id == id) {
+				if (slots[i].name != name) {
+					throw std::runtime_error("Names '" + slots[i].name + "' and '" + name + "' have the same hash.");
+				}
+				return std::make_pair(&slots[i].value, false);
+			}
+		}
+		slots[i].used = true;
+		slots[i].id = id;
+		slots[i].name = name;
+		slots[i].value = value;
+		count += 1;
+		return std::make_pair(&slots[i].value, true);
+	}
+
+	//remove the entry for 'id' (if any); returns whether something was removed:
+	bool erase(NameID id) {
+		if (slots.empty()) return false;
+		size_t i = id.hash & mask();
+		while (slots[i].used && slots[i].id != id) i = (i + 1) & mask();
+		if (!slots[i].used) return false;
+
+		//shift later members of the probe run back so lookups never stop at a hole early:
+		size_t hole = i;
+		for (size_t j = (i + 1) & mask(); slots[j].used; j = (j + 1) & mask()) {
+			size_t home = slots[j].id.hash & mask();
+			//can slot j move to 'hole'? (only if its home isn't cyclically in (hole, j]):
+			bool stays = (hole <= j ? (hole < home && home <= j) : (hole < home || home <= j));
+			if (stays) continue;
+			slots[hole] = std::move(slots[j]);
+			hole = j;
+		}
+		slots[hole] = Slot();
+		count -= 1;
+		return true;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	//internals:
+	size_t mask() const { assert(!slots.empty()); return slots.size() - 1; }
+	void rehash(size_t capacity) {
+		assert(capacity > count && (capacity & (capacity - 1)) == 0);
+		std::vector< Slot > old;
+		old.swap(slots);
+		slots.resize(capacity);
+		for (auto &slot : old) {
+			if (!slot.used) continue;
+			size_t i = slot.id.hash & mask();
+			while (slots[i].used) i = (i + 1) & mask();
+			slots[i] = std::move(slot);
+		}
+	}
+	std::vector< Slot > slots; //(size is zero or a power of two)
+	size_t count = 0;
+};
@@ -0,0 +1,105 @@
+#include "NetSession.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	//every packet starts with this, followed by 'count' bytes of VolleyballSim::Inputs::to_bits() controls:
+	struct PacketHeader {
+		char magic[4] = {'v', 'b', 'n', '0'};
+		uint32_t ack = 0; //controls received from the packet's recipient so far
+		uint32_t first = 0; //frame of the first control carried
+		uint32_t count = 0;
+	};
+	static_assert(sizeof(PacketHeader) == 16, "PacketHeader should be packed");
+
+	uint32_t const MaxControlsPerPacket = 255;
+}
+
+NetSession::NetSession(Config const &config_, VolleyballSim const &initial, float dt, CollisionWorld const *world)
+	: rollback(initial, dt, config_.peer_host.empty(), config_.input_delay, world), config(config_), socket(config_.port), random(config_.seed) {
+	if (!is_host()) {
+		peer = UdpSocket::resolve(config.peer_host, config.peer_port);
+		have_peer = true;
+	}
+}
+
+void NetSession::poll() {
+	UdpSocket::Address from;
+	while (socket.receive(&from, &buffer)) {
+		PacketHeader header;
+		if (buffer.size() < sizeof(header)) continue;
+		std::memcpy(&header, buffer.data(), sizeof(header));
+		if (std::memcmp(header.magic, PacketHeader().magic, 4) != 0) continue;
+		if (header.count > buffer.size() - sizeof(header)) continue;
+		if (!have_peer) {
+			peer = from;
+			have_peer = true;
+		}
+		if (from != peer) continue; //(someone else; only one peer per session)
+
+		heard = true;
+		packets_received += 1;
+		acked = std::max(acked, std::min(header.ack, rollback.local_count()));
+		//(add_remote skips controls already seen, so overlapping packets are fine)
+		for (uint32_t i = 0; i < header.count; ++i) {
+			rollback.add_remote(header.first + i, buffer[sizeof(header) + i]);
+		}
+	}
+	rollback.catch_up();
+
+	//keep the peer up to date even when there's nothing new (e.g., while waiting on it):
+	if (!sent_since_poll) send();
+	sent_since_poll = false;
+
+	//release held-back packets that are due:
+	auto now = Clock::now();
+	for (auto &d : delayed) {
+		if (d.due <= now) {
+			socket.send(peer, d.packet.data(), d.packet.size());
+		}
+	}
+	delayed.erase(std::remove_if(delayed.begin(), delayed.end(), [now](Delayed const &d) {
+		return d.due <= now;
+	}), delayed.end());
+}
+
+bool NetSession::advance(VolleyballSim::Inputs const &local) {
+	if (!rollback.advance(local)) return false;
+	send();
+	return true;
+}
+
+void NetSession::send() {
+	sent_since_poll = true;
+	if (!have_peer) return;
+
+	PacketHeader header;
+	header.ack = rollback.remote_count();
+	header.first = acked;
+	header.count = std::min(rollback.local_count() - acked, MaxControlsPerPacket);
+
+	std::vector< uint8_t > packet(sizeof(header) + header.count);
+	std::memcpy(packet.data(), &header, sizeof(header));
+	for (uint32_t i = 0; i < header.count; ++i) {
+		packet[sizeof(header) + i] = rollback.local_bits(header.first + i);
+	}
+	transmit(packet);
+}
+
+void NetSession::transmit(std::vector< uint8_t > const &packet) {
+	packets_sent += 1;
+	if (config.loss > 0.0f && std::uniform_real_distribution< float >(0.0f, 1.0f)(random) < config.loss) {
+		packets_dropped += 1;
+		return;
+	}
+	if (config.latency <= 0.0f && config.jitter <= 0.0f) {
+		socket.send(peer, packet.data(), packet.size());
+		return;
+	}
+	float hold = config.latency + std::uniform_real_distribution< float >(0.0f, std::max(0.0f, config.jitter))(random);
+	Delayed d;
+	d.due = Clock::now() + std::chrono::duration_cast< Clock::duration >(std::chrono::duration< float >(hold));
+	d.packet = packet;
+	delayed.emplace_back(std::move(d));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Rollback.hpp"
+#include "UdpSocket.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+//NetSession plays a Rollback match against another process over UDP:
+// every packet carries all of this side's controls the peer hasn't acknowledged yet (so a lost
+// packet is covered by the next one) and acknowledges the peer's controls received so far.
+//The host (player 1) waits to be contacted; the other side (player 2) connects to it.
+// Both sides must start from the same state with the same step size.
+struct NetSession {
+	struct Config {
+		uint16_t port = 0; //local port (0 picks a free one)
+		std::string peer_host; //who to contact; empty to host (and wait to be contacted)
+		uint16_t peer_port = 0;
+		uint32_t input_delay = 2; //frames (see Rollback)
+		//for testing on one machine: each packet sent is held back 'latency' plus up to 'jitter'
+		// seconds (so packets may arrive out of order), and dropped with probability 'loss':
+		float latency = 0.0f;
+		float jitter = 0.0f;
+		float loss = 0.0f;
+		uint32_t seed = 1;
+	};
+
+	//'world' is the court both sides play on (see Rollback).
+	//note: throws if the socket can't be set up or the peer can't be found.
+	NetSession(Config const &config, VolleyballSim const &initial, float dt, CollisionWorld const *world = nullptr);
+
+	bool is_host() const { return config.peer_host.empty(); }
+	//heard from the peer at least once:
+	bool connected() const { return heard; }
+
+	//(call every frame) receive the peer's controls, fixing up mispredicted frames, and keep the peer up to date:
+	// note: throws if the match can no longer be kept in sync (see Rollback::catch_up).
+	void poll();
+
+	//simulate one frame with this side's controls and send them (see Rollback::advance):
+	bool advance(VolleyballSim::Inputs const &local);
+
+	Rollback rollback;
+
+	uint32_t packets_sent = 0;
+	uint32_t packets_dropped = 0; //(by 'loss')
+	uint32_t packets_received = 0;
+
+	//internals:
+	Config config;
+	UdpSocket socket;
+	UdpSocket::Address peer;
+	bool have_peer = false; //(the host learns its peer from the first packet it gets)
+	bool heard = false;
+	uint32_t acked = 0; //how many of our controls the peer has confirmed
+	bool sent_since_poll = false;
+	void send();
+	void transmit(std::vector< uint8_t > const &packet); //send now, or hold back (see Config)
+	typedef std::chrono::steady_clock Clock;
+	struct Delayed {
+		Clock::time_point due;
+		std::vector< uint8_t > packet;
+	};
+	std::vector< Delayed > delayed;
+	std::mt19937 random;
+	std::vector< uint8_t > buffer; //(reused for received packets)
+};
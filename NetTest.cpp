@@ -0,0 +1,87 @@
+//Plays a networked match between two NetSessions in one process, over UDP on 127.0.0.1 with packets held back
+// and dropped, and checks that both sides end up with byte-identical states.
+// Build with 'jam net_test' and run dist/net_test; exits nonzero on failure.
+
+#include "NetSession.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+
+//compare every state field byte for byte (not the whole struct, whose padding bytes are arbitrary):
+static bool same_bits(VolleyballSim const &a, VolleyballSim const &b) {
+	auto same = [](void const *x, void const *y, size_t size) { return std::memcmp(x, y, size) == 0; };
+	#define SAME(FIELD) same(&a.FIELD, &b.FIELD, sizeof(a.FIELD))
+	return SAME(p1.x) && SAME(p1.y) && SAME(p1.vel_y) && SAME(p1.can_jump) && SAME(p1.jumped)
+		&& SAME(p2.x) && SAME(p2.y) && SAME(p2.vel_y) && SAME(p2.can_jump) && SAME(p2.jumped)
+		&& SAME(ball_x) && SAME(ball_y) && SAME(ball_vel_x) && SAME(ball_vel_y)
+		&& SAME(net_x) && SAME(net_y)
+		&& SAME(p1_score) && SAME(p2_score) && SAME(p1_touch_last) && SAME(game_over);
+	#undef SAME
+}
+
+int main() {
+	uint32_t const Frames = 600;
+	float const dt = 1.0f / 60.0f;
+
+	VolleyballSim initial;
+	initial.p1.x = -5.0f;
+	initial.p2.x = 5.0f;
+	initial.ball_x = -5.0f;
+
+	NetSession::Config host_config;
+	host_config.latency = 0.03f;
+	host_config.jitter = 0.02f;
+	host_config.loss = 0.2f;
+	host_config.seed = 1;
+	NetSession host(host_config, initial, dt);
+
+	NetSession::Config client_config = host_config;
+	client_config.peer_host = "127.0.0.1";
+	client_config.peer_port = host.socket.local_port();
+	client_config.seed = 2;
+	NetSession client(client_config, initial, dt);
+
+	//each side presses random keys (only its own player's are used), advancing as the rollback window allows:
+	std::mt19937 mt(0x2e7);
+	auto const start = std::chrono::steady_clock::now();
+	auto const timeout = std::chrono::seconds(30);
+	while (host.rollback.frame() < Frames || client.rollback.frame() < Frames
+		|| host.rollback.remote_count() < Frames || client.rollback.remote_count() < Frames) {
+		if (std::chrono::steady_clock::now() - start > timeout) {
+			std::cerr << "FAILED: match didn't finish in time (host at frame " << host.rollback.frame() << ", "
+				<< host.rollback.remote_count() << " confirmed; client at " << client.rollback.frame() << ", "
+				<< client.rollback.remote_count() << " confirmed)." << std::endl;
+			return 1;
+		}
+		for (NetSession *session : {&host, &client}) {
+			session->poll();
+			if (session->rollback.frame() < Frames) {
+				session->advance(VolleyballSim::Inputs::from_bits(uint8_t(mt() & 0x3f)));
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	bool ok = true;
+	if (host.rollback.rollbacks == 0 || client.rollback.rollbacks == 0) {
+		std::cerr << "FAILED: expected late controls to cause rollbacks on both sides." << std::endl;
+		ok = false;
+	}
+	if (host.packets_dropped == 0 || client.packets_dropped == 0) {
+		std::cerr << "FAILED: expected some packets to be dropped." << std::endl;
+		ok = false;
+	}
+	if (!same_bits(host.rollback.state(), client.rollback.state())) {
+		std::cerr << "FAILED: host and client disagree on the state after " << Frames << " frames." << std::endl;
+		ok = false;
+	}
+
+	if (ok) {
+		std::cout << "net_test: all checks passed (" << host.rollback.rollbacks + client.rollback.rollbacks << " rollbacks, "
+			<< host.packets_dropped + client.packets_dropped << " packets dropped)." << std::endl;
+	}
+	return ok ? 0 : 1;
+}
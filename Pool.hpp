@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//Pool is a container that stores its elements in fixed-size blocks of contiguous slots:
+// - elements are constructed in place and never move, so pointers to them stay valid until erased;
+// - iteration walks the blocks in memory order (skipping empty slots);
+// - erased slots are reused, and handles carry a generation count so a handle to an erased
+//   element reports as stale rather than silently pointing at whatever reused its slot.
+template< typename T, uint32_t BlockSize = 256 >
+struct Pool {
+	struct Handle {
+		uint32_t index = -1U;
+		uint32_t generation = 0;
+		bool operator==(Handle const &o) const { return index == o.index && generation == o.generation; }
+		bool operator!=(Handle const &o) const { return !(*this == o); }
+	};
+
+	Pool() = default;
+	Pool(Pool const &) = delete;
+	Pool &operator=(Pool const &) = delete;
+	~Pool() { clear(); }
+
+	//construct a new (default-initialized) element; optionally report its handle:
+	T &emplace(Handle *handle = nullptr) {
+		uint32_t index;
+		if (!free_slots.empty()) {
+			index = free_slots.back();
+			free_slots.pop_back();
+		} else {
+			index = uint32_t(alive.size());
+			if (index % BlockSize == 0) {
+				blocks.emplace_back(new Block);
+			}
+			alive.emplace_back(0);
+			generations.emplace_back(0);
+		}
+		T *t = new (slot(index)) T();
+		alive[index] = 1;
+		count += 1;
+		if (handle) {
+			handle->index = index;
+			handle->generation = generations[index];
+		}
+		return *t;
+	}
+
+	//destroy the element referred to by 'handle' (which must not be stale):
+	void erase(Handle handle) {
+		assert(get(handle));
+		slot(handle.index)->~T();
+		alive[handle.index] = 0;
+		generations[handle.index] += 1;
+		free_slots.emplace_back(handle.index);
+		count -= 1;
+	}
+
+	//element referred to by 'handle', or nullptr if it has been erased:
+	T *get(Handle handle) {
+		if (handle.index >= alive.size() || !alive[handle.index] || generations[handle.index] != handle.generation) return nullptr;
+		return slot(handle.index);
+	}
+	T const *get(Handle handle) const {
+		return const_cast< Pool * >(this)->get(handle);
+	}
+
+	void clear() {
+		for (uint32_t i = 0; i < alive.size(); ++i) {
+			if (alive[i]) slot(i)->~T();
+		}
+		blocks.clear();
+		alive.clear();
+		generations.clear();
+		free_slots.clear();
+		count = 0;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	template< typename Value, typename Owner >
+	struct Iterator {
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Value value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef Value *pointer;
+		typedef Value &reference;
+
+		Owner *pool;
+		uint32_t index;
+		Iterator(Owner *pool_, uint32_t index_) : pool(pool_), index(index_) { skip(); }
+		void skip() {
+			while (index < pool->alive.size() && !pool->alive[index]) ++index;
+		}
+		Value &operator*() const { return *pool->slot(index); }
+		Value *operator->() const { return pool->slot(index); }
+		Iterator &operator++() { ++index; skip(); return *this; }
+		Iterator operator++(int) { Iterator ret = *this; ++*this; return ret; }
+		bool operator==(Iterator const &o) const { return index == o.index; }
+		bool operator!=(Iterator const &o) const { return index != o.index; }
+	};
+	typedef Iterator< T, Pool > iterator;
+	typedef Iterator< T const, Pool const > const_iterator;
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, uint32_t(alive.size())); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, uint32_t(alive.size())); }
+
+	//internals:
+	struct Block {
+		typename std::aligned_storage< sizeof(T), alignof(T) >::type slots[BlockSize];
+	};
+	T *slot(uint32_t index) const {
+		return reinterpret_cast< T * >(&blocks[index / BlockSize]->slots[index % BlockSize]);
+	}
+	std::vector< std::unique_ptr< Block > > blocks;
+	std::vector< uint8_t > alive; //per slot
+	std::vector< uint32_t > generations; //per slot; bumped on erase
+	std::vector< uint32_t > free_slots;
+	size_t count = 0;
+};
@@ -0,0 +1,72 @@
+#include "Replay.hpp"
+#include "read_chunk.hpp"
+#include "write_chunk.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable< VolleyballSim >::value, "VolleyballSim is stored as raw bytes");
+
+namespace {
+	struct ReplayHeader {
+		uint32_t version = 3; //(2: fast balls are sub-stepped; 3: the ball is held within +/- WallX again; older recordings may play out differently)
+		float dt = 0.0f;
+		uint32_t sim_size = 0;
+	};
+	static_assert(sizeof(ReplayHeader) == 12, "Replay header should be packed");
+}
+
+void Replay::save(std::string const &filename) const {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	}
+
+	std::vector< ReplayHeader > header(1);
+	header[0].dt = dt;
+	header[0].sim_size = sizeof(VolleyballSim);
+	write_chunk(file, "rpl0", header);
+
+	std::vector< char > sim(sizeof(VolleyballSim));
+	std::memcpy(&sim[0], &initial, sizeof(VolleyballSim));
+	write_chunk(file, "sim0", sim);
+
+	write_chunk(file, "inp0", inputs);
+}
+
+void Replay::load(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+	}
+
+	std::vector< ReplayHeader > header;
+	read_chunk(file, "rpl0", &header);
+	if (header.size() != 1 || header[0].version != 3) {
+		throw std::runtime_error("Unsupported replay header in '" + filename + "'.");
+	}
+	if (!std::isfinite(header[0].dt) || !(header[0].dt > 0.0f)) {
+		throw std::runtime_error("Unsupported replay header in '" + filename + "' (step size must be positive).");
+	}
+	if (header[0].sim_size != sizeof(VolleyballSim)) {
+		throw std::runtime_error("Replay '" + filename + "' was recorded with a different simulation layout.");
+	}
+	dt = header[0].dt;
+
+	std::vector< char > sim;
+	read_chunk(file, "sim0", &sim);
+	if (sim.size() != sizeof(VolleyballSim)) {
+		throw std::runtime_error("Replay '" + filename + "' has a malformed simulation state.");
+	}
+	std::memcpy(&initial, &sim[0], sizeof(VolleyballSim));
+
+	read_chunk(file, "inp0", &inputs);
+}
+
+void Replay::play(VolleyballSim *sim, CollisionWorld const *world) const {
+	for (uint8_t bits : inputs) {
+		sim->step(dt, VolleyballSim::Inputs::from_bits(bits), world);
+	}
+}
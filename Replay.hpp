@@ -0,0 +1,29 @@
+#pragma once
+
+#include "VolleyballSim.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Replay is a recorded match: the starting simulation state, the step size, and the
+// controls for every step. Because VolleyballSim is deterministic, stepping a copy of
+// 'initial' through 'inputs' reproduces the match exactly -- provided it collides with the
+// same CollisionWorld (which isn't saved; see play()).
+//
+//On disk it is a sequence of read_chunk()-style chunks:
+// "rpl0" header (version, dt, size of the simulation state),
+// "sim0" raw VolleyballSim bytes,
+// "inp0" one VolleyballSim::Inputs::to_bits() byte per step.
+struct Replay {
+	VolleyballSim initial;
+	float dt = 1.0f / 60.0f;
+	std::vector< uint8_t > inputs;
+
+	//note: both will throw on failure.
+	void save(std::string const &filename) const;
+	void load(std::string const &filename);
+
+	//step 'sim' through every recorded input (as fast as possible), colliding with 'world' if given:
+	void play(VolleyballSim *sim, CollisionWorld const *world = nullptr) const;
+};
@@ -0,0 +1,73 @@
+#include "Rollback.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+constexpr uint32_t Rollback::MaxRollback;
+
+Rollback::Rollback(VolleyballSim const &initial, float dt_, bool local_is_p1, uint32_t input_delay, CollisionWorld const *world_) : dt(dt_), world(world_), current(initial), states(MaxRollback + 1) {
+	uint8_t const p1_bits = 0x07; //(p1's left, right, and jump; p2's are the next three -- see Inputs::to_bits())
+	local_mask = (local_is_p1 ? p1_bits : uint8_t(p1_bits << 3));
+	remote_mask = (local_is_p1 ? uint8_t(p1_bits << 3) : p1_bits);
+	local_inputs.assign(input_delay, 0); //(nobody presses anything during the delay)
+	guesses.resize(MaxRollback + 1);
+}
+
+bool Rollback::advance(VolleyballSim::Inputs const &local) {
+	catch_up();
+	if (frame_count >= remote_count() + MaxRollback) return false;
+
+	local_inputs.emplace_back(local.to_bits() & local_mask);
+	assert(local_count() > frame_count);
+	step();
+	return true;
+}
+
+void Rollback::add_remote(uint32_t frame, uint8_t bits) {
+	if (frame != remote_count()) return;
+	bits &= remote_mask;
+	remote_inputs.emplace_back(bits);
+	if (frame < frame_count && guesses[frame % guesses.size()] != bits) {
+		rewind_to = std::min(rewind_to, frame);
+	}
+}
+
+void Rollback::catch_up() {
+	if (rewind_to == ~0u) return;
+	auto before = std::chrono::steady_clock::now();
+
+	//(only frames since the last confirmed one can have been guessed, and those should all still be in the ring;
+	// if not, re-simulating from the wrong state would silently desync the two sides, so stop instead)
+	if (!(rewind_to < frame_count) || !states.has(rewind_to)) {
+		throw std::runtime_error("Rollback to frame " + std::to_string(rewind_to) + " (now at frame "
+			+ std::to_string(frame_count) + ") is past the oldest saved state; the match can't be kept in sync.");
+	}
+	uint32_t target = frame_count;
+	frame_count = rewind_to;
+	states.restore(frame_count, &current);
+	while (frame_count < target) {
+		step();
+	}
+
+	rollbacks += 1;
+	resimulated += target - rewind_to;
+	rewind_to = ~0u;
+	slowest_rollback = std::max(slowest_rollback, std::chrono::duration< float >(std::chrono::steady_clock::now() - before).count());
+}
+
+uint8_t Rollback::guess(uint32_t frame) const {
+	if (frame < remote_count()) return remote_inputs[frame];
+	//(players mostly keep holding whatever they were holding)
+	return remote_inputs.empty() ? 0 : remote_inputs.back();
+}
+
+void Rollback::step() {
+	uint32_t slot = frame_count % guesses.size();
+	states.save(frame_count, current);
+	guesses[slot] = guess(frame_count);
+	current.step(dt, VolleyballSim::Inputs::from_bits(local_inputs[frame_count] | guesses[slot]), world);
+	frame_count += 1;
+}
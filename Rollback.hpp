@@ -0,0 +1,69 @@
+#pragma once
+
+#include "SnapshotRing.hpp"
+#include "VolleyballSim.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//Rollback runs a two-player match where the other player's controls arrive late:
+// each frame is simulated right away with a guess for the remote controls (whatever they were last);
+// when the real controls for a frame arrive and differ from the guess, the match is rewound to that
+// frame and simulated forward again. It knows nothing about the network (see NetSession).
+//
+//Frames are numbered from 0; frame f's inputs step the state from 'f' to 'f+1'.
+struct Rollback {
+	//'local_is_p1' picks which half of the controls belong to this side.
+	// local controls are delayed by 'input_delay' frames, which gives the remote ones time to arrive.
+	// every frame is stepped against 'world' (see VolleyballSim::step), which must outlive this.
+	Rollback(VolleyballSim const &initial, float dt, bool local_is_p1, uint32_t input_delay, CollisionWorld const *world = nullptr);
+
+	//how far the prediction may run ahead of the remote player's confirmed controls:
+	static constexpr uint32_t MaxRollback = 30;
+
+	//simulate one frame with this side's controls (only its own player's controls are used);
+	// returns false -- and does nothing -- if that would get too far ahead of the remote controls.
+	// note: throws if catching up fails (see catch_up()).
+	bool advance(VolleyballSim::Inputs const &local);
+
+	//the remote player's controls for 'frame' (only that player's controls are used):
+	// frames must arrive in order; repeats and frames past the next expected one are ignored.
+	void add_remote(uint32_t frame, uint8_t bits);
+
+	//re-simulate now if late remote controls showed a guess was wrong (advance() also does this):
+	// note: throws if the wrong guess is older than the saved states (the match can't be kept in sync).
+	void catch_up();
+
+	//latest state (predicted past remote_count()):
+	VolleyballSim const &state() const { return current; }
+	//the state one frame before state() -- as (re-)simulated, so it reflects any rollback since;
+	// returns false if there is no such frame:
+	bool previous_state(VolleyballSim *state) const { return frame_count > 0 && states.restore(frame_count - 1, state); }
+	uint32_t frame() const { return frame_count; }
+
+	//local controls are known for frames [0, local_count()), remote ones for [0, remote_count()):
+	uint32_t local_count() const { return uint32_t(local_inputs.size()); }
+	uint32_t remote_count() const { return uint32_t(remote_inputs.size()); }
+	uint8_t local_bits(uint32_t frame) const { return local_inputs[frame]; }
+
+	//how many rollbacks happened, how many frames they re-simulated, and the slowest one (seconds):
+	uint32_t rollbacks = 0;
+	uint32_t resimulated = 0;
+	float slowest_rollback = 0.0f;
+
+	//internals:
+	float dt;
+	CollisionWorld const *world;
+	uint8_t local_mask, remote_mask; //which Inputs::to_bits() bits belong to each side
+	VolleyballSim current;
+	uint32_t frame_count = 0;
+	//controls for every frame so far (a byte per frame per side, so an hour of play is ~200k each):
+	std::vector< uint8_t > local_inputs; //(runs 'input_delay' frames ahead of 'frame_count')
+	std::vector< uint8_t > remote_inputs; //confirmed only
+	//rings of (MaxRollback + 1) entries, indexed by frame:
+	SnapshotRing< VolleyballSim > states; //state at the start of each recent frame
+	std::vector< uint8_t > guesses; //remote controls each recent frame was simulated with
+	uint32_t rewind_to = ~0u; //earliest frame simulated with a wrong guess, or ~0u
+	uint8_t guess(uint32_t frame) const; //best current idea of the remote controls for 'frame'
+	void step(); //simulate frame 'frame_count'
+};
@@ -3,57 +3,84 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+uint32_t Scene::Transform::structure_revision = 0;
 
 glm::mat4 Scene::Transform::make_local_to_parent() const {
 	return glm::mat4( //translate
 		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
 		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
 		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
-		glm::vec4(position, 1.0f)
+		glm::vec4(position_, 1.0f)
 	)
-	* glm::mat4_cast(rotation) //rotate
+	* glm::mat4_cast(rotation_) //rotate
 	* glm::mat4( //scale
-		glm::vec4(scale.x, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, scale.y, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, scale.z, 0.0f),
+		glm::vec4(scale_.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, scale_.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, scale_.z, 0.0f),
 		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
 	);
 }
 
 glm::mat4 Scene::Transform::make_parent_to_local() const {
 	glm::vec3 inv_scale;
-	inv_scale.x = (scale.x == 0.0f ? 0.0f : 1.0f / scale.x);
-	inv_scale.y = (scale.y == 0.0f ? 0.0f : 1.0f / scale.y);
-	inv_scale.z = (scale.z == 0.0f ? 0.0f : 1.0f / scale.z);
+	inv_scale.x = (scale_.x == 0.0f ? 0.0f : 1.0f / scale_.x);
+	inv_scale.y = (scale_.y == 0.0f ? 0.0f : 1.0f / scale_.y);
+	inv_scale.z = (scale_.z == 0.0f ? 0.0f : 1.0f / scale_.z);
 	return glm::mat4( //un-scale
 		glm::vec4(inv_scale.x, 0.0f, 0.0f, 0.0f),
 		glm::vec4(0.0f, inv_scale.y, 0.0f, 0.0f),
 		glm::vec4(0.0f, 0.0f, inv_scale.z, 0.0f),
 		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
 	)
-	* glm::mat4_cast(glm::inverse(rotation)) //un-rotate
+	* glm::mat4_cast(glm::inverse(rotation_)) //un-rotate
 	* glm::mat4( //un-translate
 		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
 		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
 		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
-		glm::vec4(-position, 1.0f)
+		glm::vec4(-position_, 1.0f)
 	);
 }
 
 glm::mat4 Scene::Transform::make_local_to_world() const {
-	if (parent) {
-		return parent->make_local_to_world() * make_local_to_parent();
-	} else {
-		return make_local_to_parent();
+	if (local_to_world_dirty) {
+		if (parent) {
+			local_to_world_cache = parent->make_local_to_world() * make_local_to_parent();
+		} else {
+			local_to_world_cache = make_local_to_parent();
+		}
+		local_to_world_dirty = false;
 	}
+	return local_to_world_cache;
 }
 
 glm::mat4 Scene::Transform::make_world_to_local() const {
-	if (parent) {
-		return make_parent_to_local() * parent->make_world_to_local();
-	} else {
-		return make_parent_to_local();
+	if (world_to_local_dirty) {
+		if (parent) {
+			world_to_local_cache = make_parent_to_local() * parent->make_world_to_local();
+		} else {
+			world_to_local_cache = make_parent_to_local();
+		}
+		world_to_local_dirty = false;
+	}
+	return world_to_local_cache;
+}
+
+void Scene::Transform::mark_dirty() {
+	//a clean descendant would need a clean parent, so if this is already dirty, so is everything below:
+	if (local_to_world_dirty && world_to_local_dirty) return;
+	local_to_world_dirty = true;
+	world_to_local_dirty = true;
+	for (Transform *child = last_child; child != nullptr; child = child->prev_sibling) {
+		child->mark_dirty();
 	}
 }
 
@@ -96,51 +123,368 @@ void Scene::Transform::set_parent(Transform *new_parent, Transform *before) {
 		}
 		if (prev_sibling) prev_sibling->next_sibling = this;
 	}
+	structure_revision += 1; //flattened copies now have the wrong parent indices
+	mark_dirty(); //world matrices now come from a different chain
 	DEBUG_assert_valid_pointers();
 }
 
 //---------------------------
 
+void Scene::FlatHierarchy::build(std::vector< Transform const * > const &leaves, std::vector< uint32_t > *leaf_indices) {
+	assert(leaf_indices);
+	transforms.clear();
+	parents.clear();
+
+	//collect every transform along with its depth (ancestors too, even if not in 'leaves'):
+	std::unordered_map< Transform const *, uint32_t > depths;
+	for (Transform const *leaf : leaves) {
+		//walk up until reaching something already seen:
+		std::vector< Transform const * > chain;
+		for (Transform const *t = leaf; t != nullptr && depths.count(t) == 0; t = t->parent) {
+			chain.emplace_back(t);
+		}
+		for (auto t = chain.rbegin(); t != chain.rend(); ++t) {
+			uint32_t depth = ((*t)->parent ? depths[(*t)->parent] + 1 : 0);
+			depths.insert(std::make_pair(*t, depth));
+			transforms.emplace_back(*t);
+		}
+	}
+
+	//sorting by depth puts parents before children:
+	std::stable_sort(transforms.begin(), transforms.end(), [&depths](Transform const *a, Transform const *b) {
+		return depths[a] < depths[b];
+	});
+
+	std::unordered_map< Transform const *, uint32_t > index;
+	index.reserve(transforms.size());
+	for (uint32_t i = 0; i < transforms.size(); ++i) {
+		index.insert(std::make_pair(transforms[i], i));
+	}
+	parents.reserve(transforms.size());
+	for (Transform const *t : transforms) {
+		parents.emplace_back(t->parent ? index[t->parent] : -1U);
+	}
+
+	leaf_indices->clear();
+	leaf_indices->reserve(leaves.size());
+	for (Transform const *leaf : leaves) {
+		leaf_indices->emplace_back(index[leaf]);
+	}
+
+	local_to_world.resize(transforms.size());
+	revision = Transform::structure_revision;
+}
+
+void Scene::FlatHierarchy::update() {
+	assert(!is_stale());
+	for (uint32_t i = 0; i < transforms.size(); ++i) {
+		Transform const &t = *transforms[i];
+		if (t.local_to_world_dirty) {
+			if (parents[i] != -1U) {
+				assert(parents[i] < i);
+				t.local_to_world_cache = local_to_world[parents[i]] * t.make_local_to_parent();
+			} else {
+				t.local_to_world_cache = t.make_local_to_parent();
+			}
+			t.local_to_world_dirty = false;
+		}
+		local_to_world[i] = t.local_to_world_cache;
+	}
+}
+
+//---------------------------
+
 glm::mat4 Scene::Camera::make_projection() const {
 	return glm::infinitePerspective( fovy, aspect, near );
 }
 
 //---------------------------
 
+//The sides and near plane of the view frustum, in world space, for culling bounding boxes.
+// The four side planes are stored as structure-of-arrays, so one SSE operation handles all four.
+// (the camera's projection has no far plane)
+namespace {
+struct Frustum {
+	alignas(16) float a[4], b[4], c[4], d[4]; //side plane i is a[i] x + b[i] y + c[i] z + d[i] >= 0
+	alignas(16) float abs_a[4], abs_b[4], abs_c[4];
+	glm::vec4 near;
+
+	explicit Frustum(glm::mat4 const &world_to_clip) {
+		//planes come from rows of the clip matrix (-w <= x <= w, etc.):
+		auto row = [&world_to_clip](int r) {
+			return glm::vec4(world_to_clip[0][r], world_to_clip[1][r], world_to_clip[2][r], world_to_clip[3][r]);
+		};
+		glm::vec4 sides[4] = {
+			row(3) + row(0), row(3) - row(0), //left, right
+			row(3) + row(1), row(3) - row(1), //bottom, top
+		};
+		for (int i = 0; i < 4; ++i) {
+			a[i] = sides[i].x;
+			b[i] = sides[i].y;
+			c[i] = sides[i].z;
+			d[i] = sides[i].w;
+			abs_a[i] = std::abs(a[i]);
+			abs_b[i] = std::abs(b[i]);
+			abs_c[i] = std::abs(c[i]);
+		}
+		near = row(3) + row(2);
+	}
+
+	//is any part of the box with this center and half-size in front of every plane?
+	bool overlaps(glm::vec3 const &center, glm::vec3 const &radius) const {
+		//(a box is outside a plane if even its corner nearest the plane's inside is outside)
+		if (glm::dot(glm::vec3(near), center) + near.w + glm::dot(glm::abs(glm::vec3(near)), radius) < 0.0f) return false;
+		#if defined(__SSE2__) || defined(_M_X64)
+		__m128 distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(a), _mm_set1_ps(center.x)), _mm_mul_ps(_mm_load_ps(b), _mm_set1_ps(center.y))),
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(c), _mm_set1_ps(center.z)), _mm_load_ps(d))
+		);
+		__m128 reach = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_load_ps(abs_a), _mm_set1_ps(radius.x)), _mm_mul_ps(_mm_load_ps(abs_b), _mm_set1_ps(radius.y))),
+			_mm_mul_ps(_mm_load_ps(abs_c), _mm_set1_ps(radius.z))
+		);
+		return _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps())) == 0;
+		#else
+		for (int i = 0; i < 4; ++i) {
+			float distance = a[i] * center.x + b[i] * center.y + c[i] * center.z + d[i];
+			float reach = abs_a[i] * radius.x + abs_b[i] * radius.y + abs_c[i] * radius.z;
+			if (distance + reach < 0.0f) return false;
+		}
+		return true;
+		#endif
+	}
+};
+}
+
 void Scene::render() {
 	glm::mat4 world_to_camera = camera.transform.make_world_to_local();
 	glm::mat4 world_to_clip = camera.make_projection() * world_to_camera;
 
-	//Get world-space position of all lights:
-	for (auto const &light : lights) {
-		glm::mat4 mv = world_to_camera * light.transform.make_local_to_world();
-		(void)mv;
+	//large scenes compute all world matrices in one flat pass up front:
+	bool flat = (objects.size() >= flat_hierarchy_threshold);
+	if (flat) {
+		if (flat_hierarchy.is_stale()) {
+			std::vector< Transform const * > leaves;
+			leaves.reserve(objects.size());
+			for (auto const &object : objects) {
+				leaves.emplace_back(&object.transform);
+			}
+			flat_hierarchy.build(leaves, &flat_object_indices);
+		}
+		flat_hierarchy.update();
 	}
 
+	Frustum frustum(world_to_clip);
+
+	//build a draw list of objects in view, sorted so objects sharing a program / vertex array / mesh are drawn together:
+	draws.clear();
+	draws.reserve(objects.size());
+	uint32_t object_index = 0;
 	for (auto const &object : objects) {
-		glm::mat4 local_to_world = object.transform.make_local_to_world();
+		glm::mat4 local_to_world = (flat
+			? flat_hierarchy.local_to_world[flat_object_indices[object_index]]
+			: object.transform.make_local_to_world()
+		);
+		object_index += 1;
+
+		if (object.min.x <= object.max.x) {
+			//world-space box around the object's (object-space) box:
+			glm::mat3 linear = glm::mat3(local_to_world);
+			glm::vec3 center = glm::vec3(local_to_world * glm::vec4(0.5f * (object.max + object.min), 1.0f));
+			glm::vec3 half = 0.5f * (object.max - object.min);
+			glm::vec3 radius = glm::abs(linear[0]) * half.x + glm::abs(linear[1]) * half.y + glm::abs(linear[2]) * half.z;
+			if (!frustum.overlaps(center, radius)) continue;
+		}
+
+		Draw draw;
+		draw.object = &object;
 
-		//compute modelview+projection (object space to clip space) matrix for this object:
-		glm::mat4 mvp = world_to_clip * local_to_world;
+		//compute modelview+projection (vertex positions to clip space) matrix for this object:
+		draw.mvp = world_to_clip * local_to_world * object.dequantize;
 
 		//compute modelview (object space to camera local space) matrix for this object:
 		glm::mat4 mv = world_to_camera * local_to_world;
 
 		//NOTE: inverse cancels out transpose unless there is scale involved
-		glm::mat3 itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+		draw.itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+
+		draws.emplace_back(draw);
+	}
+	std::sort(draws.begin(), draws.end(), [](Draw const &a, Draw const &b) {
+		if (a.object->program != b.object->program) return a.object->program < b.object->program;
+		if (a.object->vao != b.object->vao) return a.object->vao < b.object->vao;
+		if (a.object->index_type != b.object->index_type) return a.object->index_type < b.object->index_type;
+		if (a.object->base_vertex != b.object->base_vertex) return a.object->base_vertex < b.object->base_vertex;
+		if (a.object->start != b.object->start) return a.object->start < b.object->start;
+		return a.object->count < b.object->count;
+	});
+
+	if (uniform_stream.buffer == 0) {
+		//per-object blocks are bound by offset, which must be suitably aligned:
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		uniform_alignment = std::max(alignment, 1);
+		uniform_stream.alignment = std::max(uniform_stream.alignment, size_t(uniform_alignment));
+		object_stride = (uint32_t(sizeof(ObjectBlock)) + uniform_alignment - 1) / uniform_alignment * uniform_alignment;
 
-		//set up program uniforms:
-		glUseProgram(object.program);
-		if (object.program_mvp != -1U) {
-			glUniformMatrix4fv(object.program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+		//every region of the instance stream must be addressable through one buffer texture:
+		GLint max_texels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+		instance_stream.max_region_size = size_t(max_texels) * sizeof(glm::vec4) / instance_stream.fences.size() / instance_stream.alignment * instance_stream.alignment;
+		max_instances = uint32_t(instance_stream.max_region_size / (sizeof(glm::vec4) * InstanceTexels));
+	}
+
+	//group runs of the same mesh; runs long enough get drawn instanced:
+	batches.clear();
+	uint32_t instance_count = 0;
+	uint32_t object_count = 0;
+	for (uint32_t begin = 0; begin < draws.size(); /* later */) {
+		Object const &first = *draws[begin].object;
+		uint32_t end = begin + 1;
+		while (end < draws.size()
+		 && draws[end].object->program == first.program
+		 && draws[end].object->vao == first.vao
+		 && draws[end].object->index_type == first.index_type
+		 && draws[end].object->base_vertex == first.base_vertex
+		 && draws[end].object->start == first.start
+		 && draws[end].object->count == first.count) {
+			++end;
 		}
-		if (object.program_itmv != -1U) {
-			glUniformMatrix3fv(object.program_itmv, 1, GL_FALSE, glm::value_ptr(itmv));
+
+		Batch batch;
+		batch.begin = begin;
+		batch.end = end;
+		if (first.instanced_program != 0 && end - begin >= min_instances && instance_count + (end - begin) <= max_instances) {
+			batch.instanced = true;
+			instance_count += end - begin;
+		} else {
+			object_count += end - begin;
 		}
+		batches.emplace_back(batch);
+		begin = end;
+	}
 
-		glBindVertexArray(object.vao);
+	//write this frame's data straight into the streaming buffers:
+	instance_stream.begin_frame(instance_count * InstanceTexels * sizeof(glm::vec4));
+	uniform_stream.begin_frame(sizeof(FrameBlock) + uniform_alignment + object_count * object_stride);
 
-		//draw the object:
-		glDrawArrays(GL_TRIANGLES, object.start, object.count);
+	//per-frame uniform block (camera + lights):
+	FrameBlock frame;
+	frame.world_to_clip = world_to_clip;
+	frame.world_to_camera = world_to_camera;
+	frame.light_count = 0;
+	for (auto const &light : lights) {
+		if (uint32_t(frame.light_count) == MaxLights) break;
+		//directional lights shine along their local -z, so the direction *to* the light is +z:
+		glm::mat4 mv = world_to_camera * light.transform.make_local_to_world();
+		frame.light_direction[frame.light_count] = glm::vec4(glm::normalize(glm::mat3(mv) * glm::vec3(0.0f, 0.0f, 1.0f)), 0.0f);
+		frame.light_intensity[frame.light_count] = glm::vec4(light.intensity, 0.0f);
+		frame.light_count += 1;
 	}
+	GLintptr frame_offset = 0;
+	*reinterpret_cast< FrameBlock * >(uniform_stream.allocate(sizeof(FrameBlock), uniform_alignment, &frame_offset)) = frame;
+
+	for (auto &batch : batches) {
+		if (batch.instanced) {
+			//per-instance matrices, as texels of the instance buffer texture:
+			GLintptr offset = 0;
+			glm::vec4 *texels = reinterpret_cast< glm::vec4 * >(instance_stream.allocate((batch.end - batch.begin) * InstanceTexels * sizeof(glm::vec4), sizeof(glm::vec4), &offset));
+			batch.offset = offset / sizeof(glm::vec4);
+			for (uint32_t d = batch.begin; d < batch.end; ++d) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					*(texels++) = draws[d].mvp[c];
+				}
+				for (uint32_t c = 0; c < 3; ++c) {
+					*(texels++) = glm::vec4(draws[d].itmv[c], 0.0f);
+				}
+			}
+		} else {
+			//per-object uniform blocks, object_stride apart:
+			uint8_t *blocks = reinterpret_cast< uint8_t * >(uniform_stream.allocate((batch.end - batch.begin) * object_stride, uniform_alignment, &batch.offset));
+			for (uint32_t d = batch.begin; d < batch.end; ++d) {
+				ObjectBlock &block = *reinterpret_cast< ObjectBlock * >(blocks);
+				blocks += object_stride;
+				block.mvp = draws[d].mvp;
+				for (uint32_t c = 0; c < 3; ++c) {
+					block.itmv[c] = glm::vec4(draws[d].itmv[c], 0.0f);
+				}
+			}
+		}
+	}
+
+	instance_stream.unmap();
+	uniform_stream.unmap();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, FrameBinding, uniform_stream.buffer, frame_offset, sizeof(FrameBlock));
+	if (instance_count) {
+		if (instance_texture == 0) {
+			glGenTextures(1, &instance_texture);
+			glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_stream.buffer);
+		}
+		glActiveTexture(GL_TEXTURE0 + InstanceTextureUnit);
+		glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+	}
+
+	//only touch GL state when it actually changes:
+	GLuint bound_program = 0;
+	GLuint bound_vao = 0;
+	bool first = true;
+	auto bind = [&](GLuint program, GLuint vao) {
+		if (first || program != bound_program) {
+			glUseProgram(program);
+			bound_program = program;
+		}
+		if (first || vao != bound_vao) {
+			glBindVertexArray(vao);
+			bound_vao = vao;
+		}
+		first = false;
+	};
+
+	auto draw_mesh = [](Object const &object, GLsizei instances) {
+		if (object.index_type) {
+			GLuint index_size = (object.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+			GLvoid *indices = (GLbyte *)0 + size_t(object.start) * index_size;
+			if (instances == 1) {
+				glDrawElementsBaseVertex(GL_TRIANGLES, object.count, object.index_type, indices, object.base_vertex);
+			} else {
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, object.count, object.index_type, indices, instances, object.base_vertex);
+			}
+		} else {
+			if (instances == 1) {
+				glDrawArrays(GL_TRIANGLES, object.start, object.count);
+			} else {
+				glDrawArraysInstanced(GL_TRIANGLES, object.start, object.count, instances);
+			}
+		}
+	};
+
+	for (auto const &batch : batches) {
+		Object const &object = *draws[batch.begin].object;
+
+		if (batch.instanced) {
+			//draw every object in the batch with one call:
+			bind(object.instanced_program, object.vao);
+			if (object.instanced_program_base != -1U) {
+				glUniform1i(object.instanced_program_base, GLint(batch.offset));
+			}
+			draw_mesh(object, batch.end - batch.begin);
+			continue;
+		}
+
+		bind(object.program, object.vao);
+		GLintptr object_offset = batch.offset;
+		for (uint32_t d = batch.begin; d < batch.end; ++d) {
+			glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBinding, uniform_stream.buffer, object_offset, sizeof(ObjectBlock));
+			object_offset += object_stride;
+
+			//draw the object:
+			draw_mesh(object, 1);
+		}
+	}
+
+	//(regions get reused only once the GPU is past these draws)
+	instance_stream.end_frame();
+	uniform_stream.end_frame();
 }
@@ -1,17 +1,21 @@
 #pragma once
 
 #include "GL.hpp"
+#include "Pool.hpp"
+#include "StreamBuffer.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
-#include <list>
+#include <cstdint>
 
 #undef near //windows.h steps on this
 
 //Describes a 3D scene for rendering:
 struct Scene {
 	struct Transform {
-		Transform() = default;
+		Transform() {
+			structure_revision += 1;
+		}
 		Transform(Transform &) = delete;
 		~Transform() {
 			while (last_child) {
@@ -20,12 +24,20 @@ struct Scene {
 			if (parent) {
 				set_parent(nullptr);
 			}
+			structure_revision += 1;
 		}
 
-		//simple specification:
-		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
-		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); //constructor is w x y z for some reason.
-		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
+		//bumped whenever any transform is created, destroyed, or re-parented
+		// (lets flattened copies of the hierarchy know when to rebuild):
+		static uint32_t structure_revision;
+
+		//simple specification (changed only through the setters, which invalidate cached world matrices):
+		glm::vec3 const &position() const { return position_; }
+		glm::quat const &rotation() const { return rotation_; }
+		glm::vec3 const &scale() const { return scale_; }
+		void set_position(glm::vec3 const &position) { position_ = position; mark_dirty(); }
+		void set_rotation(glm::quat const &rotation) { rotation_ = rotation; mark_dirty(); }
+		void set_scale(glm::vec3 const &scale) { scale_ = scale; mark_dirty(); }
 
 		//hierarchy information:
 		Transform *parent = nullptr;
@@ -43,8 +55,24 @@ struct Scene {
 		//computed from the above:
 		glm::mat4 make_local_to_parent() const;
 		glm::mat4 make_parent_to_local() const;
+		//(world matrices are cached, so these are cheap unless something above changed)
 		glm::mat4 make_local_to_world() const;
 		glm::mat4 make_world_to_local() const;
+
+		//Invalidate cached world matrices of this transform and everything below it:
+		// (the setters above and set_parent() call this)
+		void mark_dirty();
+
+		//cache for the world matrices (a dirty transform always has dirty descendants):
+		mutable glm::mat4 local_to_world_cache;
+		mutable glm::mat4 world_to_local_cache;
+		mutable bool local_to_world_dirty = true;
+		mutable bool world_to_local_dirty = true;
+
+	private:
+		glm::vec3 position_ = glm::vec3(0.0f, 0.0f, 0.0f);
+		glm::quat rotation_ = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); //constructor is w x y z for some reason.
+		glm::vec3 scale_ = glm::vec3(1.0f, 1.0f, 1.0f);
 	};
 	struct Camera {
 		Transform transform;
@@ -61,10 +89,21 @@ struct Scene {
 		GLuint vao = 0;
 		GLuint start = 0;
 		GLuint count = 0;
+		GLenum index_type = 0; //if nonzero, draw with glDrawElements* (start is then the first index)
+		GLint base_vertex = 0;
+		glm::mat4 dequantize = glm::mat4(1.0f); //vertex positions -> object space (see Mesh::dequantize)
+		//object-space bounding box (see Mesh::min / Mesh::max), used to skip objects outside the view:
+		// (if min.x > max.x, the object has no bounds and is always drawn)
+		glm::vec3 min = glm::vec3(1.0f);
+		glm::vec3 max = glm::vec3(-1.0f);
 		//program info:
+		//(reads its mvp / itmv from the Object block at ObjectBinding; camera and lights from the Frame block at FrameBinding)
 		GLuint program = 0;
-		GLuint program_mvp = -1U; //uniform index for MVP matrix
-		GLuint program_itmv = -1U; //uniform index for inverse(transpose(mv)) matrix
+		//optional instanced version of 'program', used when several objects share this mesh:
+		// it reads per-instance matrices from the samplerBuffer on texture unit InstanceTextureUnit,
+		// 7 texels per instance (mvp columns, then itmv columns), starting at texel base + 7 * gl_InstanceID.
+		GLuint instanced_program = 0;
+		GLuint instanced_program_base = -1U; //uniform index for the batch's first instance ('base')
 	};
 	struct Light {
 		Transform transform;
@@ -72,9 +111,77 @@ struct Scene {
 		glm::vec3 intensity = glm::vec3(1.0f, 1.0f, 1.0f); //effectively, color
 	};
 
+	//Flattened copy of (part of) the transform hierarchy, sorted so parents come before children;
+	// world matrices can then be computed in one linear pass with no recursion:
+	struct FlatHierarchy {
+		std::vector< Transform const * > transforms; //parents before children
+		std::vector< uint32_t > parents; //index of each transform's parent in 'transforms', or -1U
+		std::vector< glm::mat4 > local_to_world; //filled in by update()
+		uint32_t revision = -1U; //Transform::structure_revision at build time
+
+		//gather 'leaves' and all their ancestors (leaf i ends up at transforms[leaf_indices[i]]):
+		void build(std::vector< Transform const * > const &leaves, std::vector< uint32_t > *leaf_indices);
+		bool is_stale() const { return revision != Transform::structure_revision; }
+
+		//compute local_to_world for every transform (also refreshing the transforms' own caches):
+		void update();
+	};
+
 	Camera camera;
-	std::list< Object > objects;
-	std::list< Light > lights;
+	//(pools keep objects in contiguous blocks; pointers to them stay valid until erased)
+	Pool< Object > objects;
+	Pool< Light > lights;
 
+	//uniform blocks (std140) filled by render(); programs should bind their
+	// "Frame" block to FrameBinding and their "Object" block to ObjectBinding:
+	static constexpr GLuint FrameBinding = 0;
+	static constexpr GLuint ObjectBinding = 1;
+	static constexpr uint32_t MaxLights = 8;
+	struct FrameBlock {
+		glm::mat4 world_to_clip;
+		glm::mat4 world_to_camera;
+		glm::vec4 light_direction[MaxLights]; //camera-space direction to each light (xyz)
+		glm::vec4 light_intensity[MaxLights]; //color of each light (rgb)
+		int32_t light_count;
+		int32_t padding_[3];
+	};
+	static_assert(sizeof(FrameBlock) == 400, "FrameBlock should match std140 layout.");
+	struct ObjectBlock {
+		glm::mat4 mvp;
+		glm::vec4 itmv[3]; //(std140 stores mat3 columns as vec4s)
+	};
+	static_assert(sizeof(ObjectBlock) == 112, "ObjectBlock should match std140 layout.");
+
+	//runs of at least this many objects with the same mesh (and an instanced_program) are drawn instanced:
+	uint32_t min_instances = 2;
+	static constexpr GLuint InstanceTextureUnit = 0;
+
+	//render() walks a FlatHierarchy instead of each object's parent chain once there are this many objects:
+	size_t flat_hierarchy_threshold = 1000;
+
+	//draw every object whose bounding box is (at least partly) in view:
 	void render();
+
+	//internals:
+	struct Draw {
+		Object const *object = nullptr;
+		glm::mat4 mvp;
+		glm::mat3 itmv;
+	};
+	std::vector< Draw > draws; //rebuilt (and sorted by state) every render()
+	struct Batch {
+		uint32_t begin = 0, end = 0; //range in 'draws' sharing program + mesh
+		bool instanced = false;
+		GLintptr offset = 0; //first texel in instance_stream (instanced) or first ObjectBlock's byte offset in uniform_stream
+	};
+	std::vector< Batch > batches;
+	static constexpr uint32_t InstanceTexels = 7; //vec4s per instance
+	uint32_t max_instances = 0; //per frame, so the whole instance_stream fits GL_MAX_TEXTURE_BUFFER_SIZE
+	StreamBuffer instance_stream{GL_TEXTURE_BUFFER};
+	GLuint instance_texture = 0; //buffer texture over instance_stream
+	StreamBuffer uniform_stream{GL_UNIFORM_BUFFER}; //Frame block, then Object blocks
+	GLint uniform_alignment = 1; //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	uint32_t object_stride = 0; //sizeof(ObjectBlock) rounded up to uniform_alignment
+	FlatHierarchy flat_hierarchy;
+	std::vector< uint32_t > flat_object_indices; //index in flat_hierarchy for each of 'objects', in order
 };
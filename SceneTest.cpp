@@ -0,0 +1,60 @@
+//Checks that flattened hierarchies notice structural changes to the transforms they were built from.
+//Also checks that transform setters keep cached world matrices up to date.
+// Build with 'jam scene_test' and run dist/scene_test; exits nonzero on failure.
+
+#include "Scene.hpp"
+
+#include <iostream>
+#include <vector>
+
+static bool check(bool ok, char const *what) {
+	if (!ok) std::cerr << "FAILED: " << what << std::endl;
+	return ok;
+}
+
+int main() {
+	bool ok = true;
+
+	Scene::Transform root, a, b, leaf;
+	a.set_parent(&root);
+	b.set_parent(&root);
+	leaf.set_parent(&a);
+
+	Scene::FlatHierarchy flat;
+	std::vector< uint32_t > leaf_indices;
+	flat.build(std::vector< Scene::Transform const * >{ &leaf }, &leaf_indices);
+	ok = check(!flat.is_stale(), "fresh build is not stale") && ok;
+
+	//re-parenting alone (no transforms created or destroyed) must invalidate the flat copy:
+	leaf.set_parent(&b);
+	ok = check(flat.is_stale(), "re-parent after build marks the flat copy stale") && ok;
+
+	flat.build(std::vector< Scene::Transform const * >{ &leaf }, &leaf_indices);
+	ok = check(!flat.is_stale(), "rebuild after re-parent is not stale") && ok;
+	ok = check(flat.transforms[flat.parents[leaf_indices[0]]] == &b, "rebuilt copy uses the new parent") && ok;
+
+	//detaching counts too:
+	leaf.set_parent(nullptr);
+	ok = check(flat.is_stale(), "detach after build marks the flat copy stale") && ok;
+
+	{ //changing a transform through its setters refreshes cached world matrices below it:
+		Scene::Transform parent, child;
+		child.set_parent(&parent);
+		child.set_position(glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::vec4 before = child.make_local_to_world() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); //(caches it)
+		ok = check(before == glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "child's world position starts at its offset") && ok;
+
+		parent.set_position(glm::vec3(0.0f, 2.0f, 0.0f));
+		glm::vec4 after = child.make_local_to_world() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		ok = check(after == glm::vec4(1.0f, 2.0f, 0.0f, 1.0f), "moving the parent moves the cached child") && ok;
+
+		parent.set_scale(glm::vec3(2.0f));
+		after = child.make_local_to_world() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		ok = check(after == glm::vec4(2.0f, 2.0f, 0.0f, 1.0f), "scaling the parent rescales the cached child") && ok;
+		glm::vec4 back = child.make_world_to_local() * after;
+		ok = check(glm::length(back - glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)) < 1e-5f, "the inverse cache follows too") && ok;
+	}
+
+	if (ok) std::cout << "scene_test: all checks passed." << std::endl;
+	return ok ? 0 : 1;
+}
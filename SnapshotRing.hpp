@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//SnapshotRing keeps copies of a plain-data state (e.g., VolleyballSim) for the last 'capacity' frames:
+// every slot is allocated up front, and saving or restoring a frame is a single memcpy, so it is cheap
+// enough to do every frame (rollback, rewinding, trying out moves from a position).
+//Frame f lives in slot f % capacity, so saving a frame overwrites the one 'capacity' frames before it.
+template< typename State >
+struct SnapshotRing {
+	static_assert(std::is_trivially_copyable< State >::value, "SnapshotRing copies states as raw bytes");
+
+	explicit SnapshotRing(size_t capacity) : slots(capacity), frames(capacity, Empty) {
+		assert(capacity > 0);
+	}
+
+	size_t capacity() const { return slots.size(); }
+
+	void save(uint32_t frame, State const &state) {
+		size_t slot = frame % slots.size();
+		std::memcpy(&slots[slot], &state, sizeof(State));
+		frames[slot] = frame;
+	}
+
+	//is 'frame' still held (saved, and not yet overwritten)?
+	bool has(uint32_t frame) const {
+		return frame != Empty && frames[frame % slots.size()] == frame;
+	}
+
+	//copy 'frame' back out; returns false (leaving 'state' alone) if it isn't held:
+	bool restore(uint32_t frame, State *state) const {
+		assert(state);
+		if (!has(frame)) return false;
+		std::memcpy(state, &slots[frame % slots.size()], sizeof(State));
+		return true;
+	}
+
+	//forget every frame:
+	void clear() {
+		std::fill(frames.begin(), frames.end(), Empty);
+	}
+
+	//internals:
+	static constexpr uint32_t Empty = ~0u;
+	std::vector< State > slots;
+	std::vector< uint32_t > frames; //frame held by each slot, or Empty
+};
+
+template< typename State >
+constexpr uint32_t SnapshotRing< State >::Empty;
@@ -0,0 +1,69 @@
+//Checks SnapshotRing's save / restore / overwrite rules, and that a match state round-trips through it intact.
+// Build with 'jam snapshot_test' and run dist/snapshot_test; exits nonzero on failure.
+
+#include "SnapshotRing.hpp"
+#include "VolleyballSim.hpp"
+
+#include <cstring>
+#include <iostream>
+
+static bool check(bool ok, char const *what) {
+	if (!ok) std::cerr << "FAILED: " << what << std::endl;
+	return ok;
+}
+
+int main() {
+	bool ok = true;
+
+	{ //save, restore, and overwrite, in a ring of 4:
+		SnapshotRing< int > ring(4);
+		int state = -1;
+		ok = check(!ring.has(0) && !ring.restore(0, &state) && state == -1, "an empty ring holds nothing (and restore leaves the state alone)") && ok;
+		ok = check(!ring.has(SnapshotRing< int >::Empty), "the 'Empty' marker isn't a held frame") && ok;
+
+		for (int f = 0; f < 4; ++f) ring.save(uint32_t(f), 100 + f);
+		bool all = true;
+		for (int f = 0; f < 4; ++f) all = all && ring.has(uint32_t(f)) && ring.restore(uint32_t(f), &state) && state == 100 + f;
+		ok = check(all, "saved frames can be restored") && ok;
+		ok = check(!ring.has(4), "frames not yet saved aren't held") && ok;
+
+		//wrap around: frames 4 and 5 overwrite 0 and 1:
+		ring.save(4, 104);
+		ring.save(5, 105);
+		ok = check(!ring.has(0) && !ring.has(1), "frames overwritten after wraparound are gone") && ok;
+		ok = check(ring.has(2) && ring.has(3) && ring.has(4) && ring.has(5), "the last 'capacity' frames are held after wraparound") && ok;
+		ok = check(ring.restore(5, &state) && state == 105 && ring.restore(2, &state) && state == 102, "restores after wraparound get the right frame") && ok;
+		ok = check(!ring.has(8) && !ring.has(9), "frames sharing a slot with held ones aren't mistaken for them") && ok;
+
+		//re-saving a frame (e.g., after a rollback re-simulates it) replaces it:
+		ring.save(4, 204);
+		ok = check(ring.restore(4, &state) && state == 204, "re-saving a frame replaces it") && ok;
+
+		ring.clear();
+		ok = check(!ring.has(2) && !ring.has(3) && !ring.has(4) && !ring.has(5), "clear() forgets every frame") && ok;
+	}
+
+	{ //a match state comes back exactly as it was saved:
+		SnapshotRing< VolleyballSim > ring(3);
+		VolleyballSim sim;
+		sim.ball_vel_x = 3.0f;
+		VolleyballSim::Inputs inputs;
+		inputs.p1_right = true;
+		inputs.p2_jump = true;
+		VolleyballSim saved[5];
+		for (uint32_t f = 0; f < 5; ++f) {
+			ring.save(f, sim);
+			std::memcpy(&saved[f], &sim, sizeof(VolleyballSim)); //(padding included, as the ring copies it)
+			sim.step(1.0f / 60.0f, inputs);
+		}
+		VolleyballSim restored;
+		ok = check(ring.restore(3, &restored) && std::memcmp(&restored, &saved[3], sizeof(VolleyballSim)) == 0, "a restored match state is byte-identical to the saved one") && ok;
+
+		//and stepping on from it gives the same result as the first time:
+		restored.step(1.0f / 60.0f, inputs);
+		ok = check(std::memcmp(&restored, &saved[4], sizeof(VolleyballSim)) == 0, "stepping a restored state repeats the original step") && ok;
+	}
+
+	if (ok) std::cout << "snapshot_test: all checks passed." << std::endl;
+	return ok ? 0 : 1;
+}
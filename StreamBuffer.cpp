@@ -0,0 +1,79 @@
+#include "StreamBuffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(GLenum target_, size_t alignment_, size_t frames) : target(target_), alignment(alignment_), fences(frames, nullptr) {
+	assert(alignment > 0 && frames > 0);
+}
+
+void StreamBuffer::begin_frame(size_t size) {
+	assert(!mapped && "begin_frame() without matching unmap()");
+	if (buffer == 0) {
+		glGenBuffers(1, &buffer);
+	}
+
+	current = (current + 1) % fences.size();
+	glBindBuffer(target, buffer);
+
+	size = (size + alignment - 1) / alignment * alignment;
+	if (size > region_size) {
+		//grow; re-specifying the store lets the driver retire the old one once in-flight frames finish with it:
+		region_size = std::max(size, std::min(2 * region_size, max_region_size));
+		glBufferData(target, region_size * fences.size(), nullptr, GL_STREAM_DRAW);
+		for (auto &fence : fences) {
+			if (fence) glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	GLsync &fence = fences[current];
+	if (fence) {
+		//wait for the GPU to finish reading this region (normally already done, frames ago):
+		while (true) {
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+			if (result == GL_WAIT_FAILED) throw std::runtime_error("StreamBuffer: glClientWaitSync failed.");
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	used = 0;
+	mapped_size = size;
+	if (size > 0) {
+		//the fence already guarantees the region is idle, so there is no need for the driver to synchronize:
+		mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(target, current * region_size, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (!mapped) throw std::runtime_error("StreamBuffer: failed to map buffer.");
+	}
+	glBindBuffer(target, 0);
+}
+
+void *StreamBuffer::allocate(size_t size, size_t align, GLintptr *offset) {
+	assert(offset);
+	assert(align > 0 && alignment % align == 0);
+	size_t start = (used + align - 1) / align * align;
+	if (!mapped || start + size > mapped_size) {
+		throw std::runtime_error("StreamBuffer: allocation exceeds size given to begin_frame().");
+	}
+	used = start + size;
+	*offset = GLintptr(current * region_size + start);
+	return mapped + start;
+}
+
+void StreamBuffer::unmap() {
+	if (!mapped) return;
+	glBindBuffer(target, buffer);
+	glUnmapBuffer(target);
+	glBindBuffer(target, 0);
+	mapped = nullptr;
+}
+
+void StreamBuffer::end_frame() {
+	assert(!mapped);
+	if (buffer == 0) return;
+	assert(fences[current] == nullptr);
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//StreamBuffer is a ring of per-frame regions in one GL buffer, for data that is rewritten every frame
+// (per-object uniforms, instance transforms, debug geometry).
+// Each frame writes into the next region through an unsynchronized mapping; a fence placed after the
+// frame's draws keeps the region from being rewritten until the GPU is done reading it.
+// Usage, once per frame:
+//   begin_frame(bytes) -> allocate(...) as needed -> unmap() -> draw -> end_frame()
+// (GL objects are created lazily, on the first begin_frame(), so a StreamBuffer can be declared before a context exists.)
+struct StreamBuffer {
+	//'alignment' is the alignment of every region start (and the largest alignment allocate() accepts):
+	StreamBuffer(GLenum target, size_t alignment = 256, size_t frames = 3);
+	StreamBuffer(StreamBuffer const &) = delete;
+
+	//advance to the next region (waiting on its fence if the GPU is still using it),
+	// make sure it holds at least 'size' bytes, and map it for writing:
+	void begin_frame(size_t size);
+
+	//reserve 'size' bytes of the mapped region; returns a pointer to write through
+	// and stores the corresponding offset into 'buffer' in *offset:
+	void *allocate(size_t size, size_t alignment, GLintptr *offset);
+
+	//finish writing (must happen before drawing from the region):
+	void unmap();
+
+	//fence the region (call once every draw that reads this frame's data has been issued):
+	void end_frame();
+
+	GLenum target;
+	size_t alignment;
+	GLuint buffer = 0;
+	size_t region_size = 0; //bytes per frame
+	size_t max_region_size = size_t(-1); //growth stops here (unless a frame asks for more)
+	size_t current = 0; //index of the region being written
+	uint8_t *mapped = nullptr;
+	size_t mapped_size = 0; //bytes of the current region that are mapped
+	size_t used = 0; //bytes allocated in the current region
+	std::vector< GLsync > fences; //one per region (or null)
+};
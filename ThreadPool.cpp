@@ -0,0 +1,82 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+	if (thread_count == 0) {
+		thread_count = std::max(1U, std::thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads.emplace_back([this]() {
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				wake.wait(lock, [this]() { return quit || !tasks.empty(); });
+				if (quit && tasks.empty()) break;
+				run_one(lock);
+			}
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::enqueue(std::function< void() > const &task) {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		tasks.emplace_back(task);
+	}
+	wake.notify_one();
+}
+
+bool ThreadPool::run_one(std::unique_lock< std::mutex > &lock) {
+	if (tasks.empty()) return false;
+	std::function< void() > task = std::move(tasks.front());
+	tasks.pop_front();
+	lock.unlock();
+	task();
+	lock.lock();
+	return true;
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain, std::function< void(size_t, size_t) > const &job) {
+	if (count == 0) return;
+	grain = std::max< size_t >(1, grain);
+
+	//single range (or no workers): not worth a trip through the queue:
+	if (count <= grain || threads.empty()) {
+		job(0, count);
+		return;
+	}
+
+	size_t remaining = (count + grain - 1) / grain;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		for (size_t begin = 0; begin < count; begin += grain) {
+			size_t end = std::min(count, begin + grain);
+			tasks.emplace_back([this, &job, &remaining, begin, end]() {
+				job(begin, end);
+				std::unique_lock< std::mutex > lock(mutex);
+				remaining -= 1;
+				if (remaining == 0) done.notify_all();
+			});
+		}
+	}
+	wake.notify_all();
+
+	//help drain the queue, then wait for stragglers:
+	std::unique_lock< std::mutex > lock(mutex);
+	while (remaining != 0) {
+		if (!run_one(lock)) {
+			done.wait(lock, [&remaining]() { return remaining == 0; });
+		}
+	}
+}
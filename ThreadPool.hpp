@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//ThreadPool is a fixed set of worker threads pulling tasks from a shared queue:
+struct ThreadPool {
+	//0 threads means "one per hardware thread":
+	explicit ThreadPool(size_t thread_count = 0);
+	~ThreadPool();
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool &operator=(ThreadPool const &) = delete;
+
+	//run 'task' on some worker at some point:
+	void enqueue(std::function< void() > const &task);
+
+	//call job(begin, end) on ranges of at most 'grain' items covering [0,count);
+	// the calling thread helps out, and the call returns once every range is done.
+	void parallel_for(size_t count, size_t grain, std::function< void(size_t, size_t) > const &job);
+
+	size_t size() const { return threads.size(); }
+
+	//internals:
+	bool run_one(std::unique_lock< std::mutex > &lock); //run a queued task, if any (lock must be held)
+	std::vector< std::thread > threads;
+	std::deque< std::function< void() > > tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	bool quit = false;
+};
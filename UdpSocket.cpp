@@ -0,0 +1,143 @@
+#include "UdpSocket.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	sockaddr_in to_sockaddr(UdpSocket::Address const &address) {
+		sockaddr_in in;
+		std::memset(&in, 0, sizeof(in));
+		in.sin_family = AF_INET;
+		in.sin_addr.s_addr = htonl(address.host);
+		in.sin_port = htons(address.port);
+		return in;
+	}
+
+	#ifdef _WIN32
+	//Winsock must be started before any socket call (WSAStartup calls are reference counted):
+	struct Winsock {
+		Winsock() {
+			WSADATA data;
+			if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+				throw std::runtime_error("Failed to start Winsock.");
+			}
+		}
+		~Winsock() {
+			WSACleanup();
+		}
+	};
+	void start_winsock() {
+		static Winsock winsock;
+	}
+	#endif
+}
+
+std::string UdpSocket::Address::to_string() const {
+	return std::to_string((host >> 24) & 0xff) + "." + std::to_string((host >> 16) & 0xff)
+		+ "." + std::to_string((host >> 8) & 0xff) + "." + std::to_string(host & 0xff)
+		+ ":" + std::to_string(port);
+}
+
+UdpSocket::Address UdpSocket::resolve(std::string const &host, uint16_t port) {
+	#ifdef _WIN32
+	start_winsock();
+	#endif
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *found = nullptr;
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || !found) {
+		throw std::runtime_error("Failed to look up host '" + host + "'.");
+	}
+	Address address;
+	address.host = ntohl(reinterpret_cast< sockaddr_in const * >(found->ai_addr)->sin_addr.s_addr);
+	address.port = port;
+	freeaddrinfo(found);
+	return address;
+}
+
+UdpSocket::UdpSocket(uint16_t port) {
+	#ifdef _WIN32
+	start_winsock();
+	SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET) {
+		throw std::runtime_error("Failed to create UDP socket.");
+	}
+	handle = uintptr_t(s);
+	u_long non_blocking = 1;
+	bool ok = (ioctlsocket(s, FIONBIO, &non_blocking) == 0);
+	#else
+	handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == -1) {
+		throw std::runtime_error("Failed to create UDP socket.");
+	}
+	bool ok = (fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0);
+	#endif
+
+	Address any;
+	any.host = INADDR_ANY;
+	any.port = port;
+	sockaddr_in in = to_sockaddr(any);
+	if (!ok || bind(handle, reinterpret_cast< sockaddr const * >(&in), sizeof(in)) != 0) {
+		#ifdef _WIN32
+		closesocket(s);
+		#else
+		close(handle);
+		#endif
+		throw std::runtime_error("Failed to bind UDP socket to port " + std::to_string(port) + ".");
+	}
+}
+
+UdpSocket::~UdpSocket() {
+	#ifdef _WIN32
+	closesocket(SOCKET(handle));
+	#else
+	close(handle);
+	#endif
+}
+
+void UdpSocket::send(Address const &to, void const *data, size_t size) {
+	sockaddr_in in = to_sockaddr(to);
+	sendto(handle, reinterpret_cast< char const * >(data), int(size), 0, reinterpret_cast< sockaddr const * >(&in), sizeof(in));
+}
+
+bool UdpSocket::receive(Address *from, std::vector< uint8_t > *data) {
+	data->resize(1500); //(largest datagram that won't be fragmented on ethernet)
+	sockaddr_in in;
+	socklen_t in_size = sizeof(in);
+	auto got = recvfrom(handle, reinterpret_cast< char * >(data->data()), int(data->size()), 0, reinterpret_cast< sockaddr * >(&in), &in_size);
+	if (got < 0) {
+		//(EWOULDBLOCK means nothing is waiting; other errors -- e.g., the peer's port being closed -- are treated the same)
+		data->clear();
+		return false;
+	}
+	data->resize(size_t(got));
+	if (from) {
+		from->host = ntohl(in.sin_addr.s_addr);
+		from->port = ntohs(in.sin_port);
+	}
+	return true;
+}
+
+uint16_t UdpSocket::local_port() const {
+	sockaddr_in in;
+	socklen_t in_size = sizeof(in);
+	if (getsockname(handle, reinterpret_cast< sockaddr * >(&in), &in_size) != 0) return 0;
+	return ntohs(in.sin_port);
+}
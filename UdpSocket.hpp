@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//UdpSocket is a non-blocking IPv4 UDP socket (BSD sockets / Winsock):
+// note: the constructor throws if the socket can't be created or bound.
+struct UdpSocket {
+	struct Address {
+		uint32_t host = 0; //IPv4 address, host byte order
+		uint16_t port = 0;
+		bool operator==(Address const &other) const { return host == other.host && port == other.port; }
+		bool operator!=(Address const &other) const { return !(*this == other); }
+		std::string to_string() const;
+	};
+
+	//look up 'host' (a name or dotted address); throws if it can't be found:
+	static Address resolve(std::string const &host, uint16_t port);
+
+	//bind to 'port' on every interface (0 picks a free port):
+	explicit UdpSocket(uint16_t port = 0);
+	~UdpSocket();
+	UdpSocket(UdpSocket const &) = delete;
+	UdpSocket &operator=(UdpSocket const &) = delete;
+
+	//send one datagram (failures are ignored -- UDP may drop it anyway):
+	void send(Address const &to, void const *data, size_t size);
+
+	//receive one waiting datagram, if any (never blocks):
+	bool receive(Address *from, std::vector< uint8_t > *data);
+
+	uint16_t local_port() const;
+
+	//internals:
+	#ifdef _WIN32
+	uintptr_t handle = ~uintptr_t(0); //SOCKET
+	#else
+	int handle = -1;
+	#endif
+};
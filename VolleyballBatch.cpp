@@ -0,0 +1,201 @@
+#include "VolleyballBatch.hpp"
+#include "ThreadPool.hpp"
+#include "VolleyballKernel.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+std::vector< size_t > VolleyballBatch::lane_widths() {
+	std::vector< size_t > widths;
+	widths.emplace_back(size_t(ScalarLanes::Width)); //(copied, so the constant needs no definition)
+	#if defined(__SSE2__) || defined(_M_X64)
+	widths.emplace_back(size_t(SSE2Lanes::Width));
+	#endif
+	#if defined(__AVX2__)
+	widths.emplace_back(size_t(AVX2Lanes::Width));
+	#endif
+	#if defined(__AVX512F__)
+	widths.emplace_back(size_t(AVX512Lanes::Width));
+	#endif
+	return widths;
+}
+
+//step matches [match, end) through the L::Width kernel, in groups of L::Width;
+// groups with a fast ball, and the leftovers, go through 'step_one':
+template< typename L, typename Fast, typename StepOne >
+static void step_groups(VolleyballLanes const &lanes, size_t match, size_t end, float dt, Fast const &fast, StepOne const &step_one) {
+	for (; match + L::Width <= end; match += L::Width) {
+		bool any_fast = false;
+		for (size_t lane = 0; lane < L::Width; ++lane) {
+			any_fast = any_fast || fast(match + lane);
+		}
+		if (!any_fast) {
+			step_ball_lanes< L >(lanes, match, dt);
+		} else {
+			for (size_t lane = 0; lane < L::Width; ++lane) {
+				step_one(match + lane);
+			}
+		}
+	}
+	for (; match < end; ++match) {
+		step_one(match);
+	}
+}
+
+void VolleyballBatch::reset(size_t count, VolleyballSim const &initial) {
+	p1_x.assign(count, initial.p1.x);
+	p1_y.assign(count, initial.p1.y);
+	p1_vel_y.assign(count, initial.p1.vel_y);
+	p1_can_jump.assign(count, initial.p1.can_jump);
+	p1_jumped.assign(count, initial.p1.jumped);
+
+	p2_x.assign(count, initial.p2.x);
+	p2_y.assign(count, initial.p2.y);
+	p2_vel_y.assign(count, initial.p2.vel_y);
+	p2_can_jump.assign(count, initial.p2.can_jump);
+	p2_jumped.assign(count, initial.p2.jumped);
+
+	ball_x.assign(count, initial.ball_x);
+	ball_y.assign(count, initial.ball_y);
+	ball_vel_x.assign(count, initial.ball_vel_x);
+	ball_vel_y.assign(count, initial.ball_vel_y);
+
+	p1_score.assign(count, initial.p1_score);
+	p2_score.assign(count, initial.p2_score);
+	p1_touch_last.assign(count, initial.p1_touch_last);
+	game_over.assign(count, initial.game_over);
+
+	net_x = initial.net_x;
+	net_y = initial.net_y;
+}
+
+VolleyballSim VolleyballBatch::get(size_t match) const {
+	assert(match < size());
+	VolleyballSim sim;
+	sim.p1.x = p1_x[match];
+	sim.p1.y = p1_y[match];
+	sim.p1.vel_y = p1_vel_y[match];
+	sim.p1.can_jump = p1_can_jump[match];
+	sim.p1.jumped = p1_jumped[match];
+
+	sim.p2.x = p2_x[match];
+	sim.p2.y = p2_y[match];
+	sim.p2.vel_y = p2_vel_y[match];
+	sim.p2.can_jump = p2_can_jump[match];
+	sim.p2.jumped = p2_jumped[match];
+
+	sim.ball_x = ball_x[match];
+	sim.ball_y = ball_y[match];
+	sim.ball_vel_x = ball_vel_x[match];
+	sim.ball_vel_y = ball_vel_y[match];
+
+	sim.net_x = net_x;
+	sim.net_y = net_y;
+
+	sim.p1_score = p1_score[match];
+	sim.p2_score = p2_score[match];
+	sim.p1_touch_last = p1_touch_last[match];
+	sim.game_over = game_over[match];
+	return sim;
+}
+
+void VolleyballBatch::set(size_t match, VolleyballSim const &sim) {
+	assert(match < size());
+	p1_x[match] = sim.p1.x;
+	p1_y[match] = sim.p1.y;
+	p1_vel_y[match] = sim.p1.vel_y;
+	p1_can_jump[match] = sim.p1.can_jump;
+	p1_jumped[match] = sim.p1.jumped;
+
+	p2_x[match] = sim.p2.x;
+	p2_y[match] = sim.p2.y;
+	p2_vel_y[match] = sim.p2.vel_y;
+	p2_can_jump[match] = sim.p2.can_jump;
+	p2_jumped[match] = sim.p2.jumped;
+
+	ball_x[match] = sim.ball_x;
+	ball_y[match] = sim.ball_y;
+	ball_vel_x[match] = sim.ball_vel_x;
+	ball_vel_y[match] = sim.ball_vel_y;
+
+	p1_score[match] = sim.p1_score;
+	p2_score[match] = sim.p2_score;
+	p1_touch_last[match] = sim.p1_touch_last;
+	game_over[match] = sim.game_over;
+}
+
+void VolleyballBatch::step_range(float dt, VolleyballSim::Inputs const *inputs, size_t begin, size_t end) {
+	assert(begin <= end && end <= size());
+
+	//matches with a fast ball need sub-steps (see VolleyballSim::step); those are rare, so they
+	// are stepped one at a time as a VolleyballSim and the kernels below skip them:
+	auto fast = [&](size_t match) -> bool {
+		return VolleyballSim::substeps_for(ball_vel_x[match], ball_vel_y[match], dt) > 1;
+	};
+
+	for (size_t match = begin; match < end; ++match) {
+		if (fast(match)) continue;
+		VolleyballSim::Inputs const &in = inputs[match];
+		step_player_lane(p1_x[match], p1_y[match], p1_vel_y[match], p1_can_jump[match], p1_jumped[match], dt, -9.5f, -0.55f, in.p1_left, in.p1_right, in.p1_jump);
+		step_player_lane(p2_x[match], p2_y[match], p2_vel_y[match], p2_can_jump[match], p2_jumped[match], dt, 0.55f, 9.5f, in.p2_left, in.p2_right, in.p2_jump);
+	}
+
+	VolleyballLanes lanes;
+	lanes.p1_x = p1_x.data();
+	lanes.p1_y = p1_y.data();
+	lanes.p2_x = p2_x.data();
+	lanes.p2_y = p2_y.data();
+	lanes.ball_x = ball_x.data();
+	lanes.ball_y = ball_y.data();
+	lanes.ball_vel_x = ball_vel_x.data();
+	lanes.ball_vel_y = ball_vel_y.data();
+	lanes.p1_score = p1_score.data();
+	lanes.p2_score = p2_score.data();
+	lanes.p1_touch_last = p1_touch_last.data();
+	lanes.game_over = game_over.data();
+	lanes.net_x = net_x;
+	lanes.net_y = net_y;
+
+	auto step_one = [&](size_t match) {
+		if (fast(match)) {
+			//(players weren't stepped above; VolleyballSim::step does both)
+			VolleyballSim sim = get(match);
+			sim.step(dt, inputs[match]);
+			set(match, sim);
+		} else {
+			step_ball_lanes< ScalarLanes >(lanes, match, dt);
+		}
+	};
+
+	//as many matches as possible go through the widest kernel (or the one asked for), the rest one at a time:
+	size_t width = (lane_width == 0 ? WideLanes::Width : lane_width);
+	if (width == ScalarLanes::Width) {
+		step_groups< ScalarLanes >(lanes, begin, end, dt, fast, step_one);
+	#if defined(__SSE2__) || defined(_M_X64)
+	} else if (width == SSE2Lanes::Width) {
+		step_groups< SSE2Lanes >(lanes, begin, end, dt, fast, step_one);
+	#endif
+	#if defined(__AVX2__)
+	} else if (width == AVX2Lanes::Width) {
+		step_groups< AVX2Lanes >(lanes, begin, end, dt, fast, step_one);
+	#endif
+	#if defined(__AVX512F__)
+	} else if (width == AVX512Lanes::Width) {
+		step_groups< AVX512Lanes >(lanes, begin, end, dt, fast, step_one);
+	#endif
+	} else {
+		throw std::runtime_error("VolleyballBatch: no kernel " + std::to_string(width) + " lanes wide is compiled in.");
+	}
+}
+
+void VolleyballBatch::step(float dt, VolleyballSim::Inputs const *inputs, ThreadPool *pool) {
+	assert(inputs || size() == 0);
+	if (pool) {
+		pool->parallel_for(size(), grain, [this, dt, inputs](size_t begin, size_t end) {
+			step_range(dt, inputs, begin, end);
+		});
+	} else {
+		step_range(dt, inputs, 0, size());
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "VolleyballSim.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ThreadPool;
+
+//VolleyballBatch keeps many independent matches in structure-of-arrays form
+// (one array per state field) and steps them all at once:
+struct VolleyballBatch {
+	//(re)fill the batch with 'count' copies of 'initial':
+	void reset(size_t count, VolleyballSim const &initial);
+
+	size_t size() const { return ball_x.size(); }
+
+	//copy a single match out of / into the batch:
+	VolleyballSim get(size_t match) const;
+	void set(size_t match, VolleyballSim const &sim);
+
+	//advance every match by 'dt'; 'inputs' holds one entry per match.
+	// if 'pool' is given, ranges of matches are stepped on its threads.
+	void step(float dt, VolleyballSim::Inputs const *inputs, ThreadPool *pool = nullptr);
+
+	//step matches [begin,end) on the calling thread:
+	void step_range(float dt, VolleyballSim::Inputs const *inputs, size_t begin, size_t end);
+
+	//matches per thread pool task:
+	size_t grain = 1024;
+
+	//kernel width to step with: 0 for the widest one compiled in (see VolleyballKernel.hpp), or any
+	// of lane_widths() -- every width gives bit-identical results, so this only matters for testing that:
+	size_t lane_width = 0;
+	static std::vector< size_t > lane_widths(); //(widths compiled in, narrowest first; always includes 1)
+
+	//per-match state:
+	std::vector< float > p1_x, p1_y, p1_vel_y;
+	std::vector< uint8_t > p1_can_jump, p1_jumped;
+	std::vector< float > p2_x, p2_y, p2_vel_y;
+	std::vector< uint8_t > p2_can_jump, p2_jumped;
+	std::vector< float > ball_x, ball_y, ball_vel_x, ball_vel_y;
+	std::vector< int32_t > p1_score, p2_score;
+	std::vector< uint8_t > p1_touch_last, game_over;
+
+	//every match is played on the same court:
+	float net_x = 0.0f;
+	float net_y = 0.0f;
+};
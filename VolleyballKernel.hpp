@@ -0,0 +1,431 @@
+#pragma once
+
+//Branch-free volleyball step shared by VolleyballSim (one match) and VolleyballBatch (many matches).
+// The ball update (integration, walls, player corner/top/side tests, net, floor, scoring, gravity)
+// is written once against a "Lanes" interface; ScalarLanes steps one match, and the SSE2 / AVX2 /
+// AVX-512 versions step 4 / 8 / 16 matches with the same operations in the same order, so results
+// are bit-identical whichever width runs -- as long as the compiler doesn't contract a*b+c into
+// FMAs, hence -ffp-contract=off in the Jamfile.
+//
+// The widest version enabled by the compiler flags is exposed as 'WideLanes'
+// (e.g. build with -mavx2 or -mavx512f to get 8 or 16 lanes; plain x86-64 gets SSE2).
+
+#include "VolleyballSim.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//pointers to the state of consecutive matches (structure-of-arrays):
+struct VolleyballLanes {
+	float const *p1_x = nullptr;
+	float const *p1_y = nullptr;
+	float const *p2_x = nullptr;
+	float const *p2_y = nullptr;
+	float *ball_x = nullptr;
+	float *ball_y = nullptr;
+	float *ball_vel_x = nullptr;
+	float *ball_vel_y = nullptr;
+	int32_t *p1_score = nullptr;
+	int32_t *p2_score = nullptr;
+	uint8_t *p1_touch_last = nullptr;
+	uint8_t *game_over = nullptr;
+	//shared by all matches:
+	float net_x = 0.0f;
+	float net_y = 0.0f;
+};
+
+//move a player according to its controls, integrate its jump, then apply gravity:
+// (players don't interact with the ball's state, so this part stays scalar)
+template< typename Flag >
+inline void step_player_lane(float &x, float &y, float &vel_y, Flag &can_jump, Flag &jumped, float dt, float min_x, float max_x, bool left, bool right, bool jump) {
+	if (left && x > min_x) {
+		x -= VolleyballSim::PlayerSpeed * dt;
+	}
+	if (right && x < max_x) {
+		x += VolleyballSim::PlayerSpeed * dt;
+	}
+	if (jump && can_jump) {
+		vel_y = VolleyballSim::JumpSpeed;
+		can_jump = false;
+		jumped = true;
+	}
+
+	//don't let the player fall through the floor:
+	if (y != 0.5f || jumped) {
+		y += vel_y * dt;
+
+		//if the player reached the floor, reset velocity and y position:
+		if (y <= 0.5f) {
+			y = 0.5f;
+			vel_y = 0.0f;
+			can_jump = true;
+		}
+
+		jumped = false;
+	}
+
+	//don't apply gravity to players standing on the floor:
+	if (y != 0.5f) {
+		vel_y += VolleyballSim::Gravity * dt;
+	}
+}
+
+//---------------------------
+//Lanes interface: F (float lanes), I (int32 lanes), M (per-lane mask).
+// and_not(a, b) is 'a && !b'; select(m, t, f) is 'm ? t : f'.
+
+struct ScalarLanes {
+	static constexpr size_t Width = 1;
+	typedef float F;
+	typedef int32_t I;
+	typedef bool M;
+
+	static F load(float const *p) { return *p; }
+	static void store(float *p, F v) { *p = v; }
+	static I load(int32_t const *p) { return *p; }
+	static void store(int32_t *p, I v) { *p = v; }
+	static M load_flags(uint8_t const *p) { return *p != 0; }
+	static void store_flags(uint8_t *p, M m) { *p = (m ? 1 : 0); }
+
+	static F set(float v) { return v; }
+	static I set(int32_t v) { return v; }
+	static M mask(bool b) { return b; }
+
+	static F add(F a, F b) { return a + b; }
+	static F sub(F a, F b) { return a - b; }
+	static F mul(F a, F b) { return a * b; }
+	static I add(I a, I b) { return a + b; }
+
+	static M le(F a, F b) { return a <= b; }
+	static M ge(F a, F b) { return a >= b; }
+	static M eq(I a, I b) { return a == b; }
+
+	static M and_(M a, M b) { return a && b; }
+	static M or_(M a, M b) { return a || b; }
+	static M and_not(M a, M b) { return a && !b; }
+
+	static F select(M m, F t, F f) { return m ? t : f; }
+	static I select(M m, I t, I f) { return m ? t : f; }
+	static M select_mask(M m, M t, M f) { return m ? t : f; }
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+struct SSE2Lanes {
+	static constexpr size_t Width = 4;
+	typedef __m128 F;
+	typedef __m128i I;
+	typedef __m128 M;
+
+	static F load(float const *p) { return _mm_loadu_ps(p); }
+	static void store(float *p, F v) { _mm_storeu_ps(p, v); }
+	static I load(int32_t const *p) { return _mm_loadu_si128(reinterpret_cast< __m128i const * >(p)); }
+	static void store(int32_t *p, I v) { _mm_storeu_si128(reinterpret_cast< __m128i * >(p), v); }
+	static M load_flags(uint8_t const *p) {
+		int32_t bytes;
+		std::memcpy(&bytes, p, sizeof(bytes));
+		__m128i zero = _mm_setzero_si128();
+		__m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+		return _mm_castsi128_ps(_mm_cmpgt_epi32(v, zero));
+	}
+	static void store_flags(uint8_t *p, M m) {
+		__m128i v = _mm_and_si128(_mm_castps_si128(m), _mm_set1_epi32(1));
+		v = _mm_packs_epi32(v, v);
+		v = _mm_packus_epi16(v, v);
+		int32_t bytes = _mm_cvtsi128_si32(v);
+		std::memcpy(p, &bytes, sizeof(bytes));
+	}
+
+	static F set(float v) { return _mm_set1_ps(v); }
+	static I set(int32_t v) { return _mm_set1_epi32(v); }
+	static M mask(bool b) { return _mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0)); }
+
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static I add(I a, I b) { return _mm_add_epi32(a, b); }
+
+	static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+	static M ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+	static M eq(I a, I b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+
+	static M and_(M a, M b) { return _mm_and_ps(a, b); }
+	static M or_(M a, M b) { return _mm_or_ps(a, b); }
+	static M and_not(M a, M b) { return _mm_andnot_ps(b, a); }
+
+	static F select(M m, F t, F f) { return _mm_or_ps(_mm_and_ps(m, t), _mm_andnot_ps(m, f)); }
+	static I select(M m, I t, I f) {
+		__m128i mi = _mm_castps_si128(m);
+		return _mm_or_si128(_mm_and_si128(mi, t), _mm_andnot_si128(mi, f));
+	}
+	static M select_mask(M m, M t, M f) { return select(m, t, f); }
+};
+#endif
+
+#if defined(__AVX2__)
+struct AVX2Lanes {
+	static constexpr size_t Width = 8;
+	typedef __m256 F;
+	typedef __m256i I;
+	typedef __m256 M;
+
+	static F load(float const *p) { return _mm256_loadu_ps(p); }
+	static void store(float *p, F v) { _mm256_storeu_ps(p, v); }
+	static I load(int32_t const *p) { return _mm256_loadu_si256(reinterpret_cast< __m256i const * >(p)); }
+	static void store(int32_t *p, I v) { _mm256_storeu_si256(reinterpret_cast< __m256i * >(p), v); }
+	static M load_flags(uint8_t const *p) {
+		__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast< __m128i const * >(p)));
+		return _mm256_castsi256_ps(_mm256_cmpgt_epi32(v, _mm256_setzero_si256()));
+	}
+	static void store_flags(uint8_t *p, M m) {
+		__m256i v = _mm256_and_si256(_mm256_castps_si256(m), _mm256_set1_epi32(1));
+		__m128i w = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		w = _mm_packus_epi16(w, w);
+		_mm_storel_epi64(reinterpret_cast< __m128i * >(p), w);
+	}
+
+	static F set(float v) { return _mm256_set1_ps(v); }
+	static I set(int32_t v) { return _mm256_set1_epi32(v); }
+	static M mask(bool b) { return _mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0)); }
+
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+
+	static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static M ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static M eq(I a, I b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+
+	static M and_(M a, M b) { return _mm256_and_ps(a, b); }
+	static M or_(M a, M b) { return _mm256_or_ps(a, b); }
+	static M and_not(M a, M b) { return _mm256_andnot_ps(b, a); }
+
+	static F select(M m, F t, F f) { return _mm256_blendv_ps(f, t, m); }
+	static I select(M m, I t, I f) {
+		return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(f), _mm256_castsi256_ps(t), m));
+	}
+	static M select_mask(M m, M t, M f) { return select(m, t, f); }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct AVX512Lanes {
+	static constexpr size_t Width = 16;
+	typedef __m512 F;
+	typedef __m512i I;
+	typedef __mmask16 M;
+
+	static F load(float const *p) { return _mm512_loadu_ps(p); }
+	static void store(float *p, F v) { _mm512_storeu_ps(p, v); }
+	static I load(int32_t const *p) { return _mm512_loadu_si512(p); }
+	static void store(int32_t *p, I v) { _mm512_storeu_si512(p, v); }
+	static M load_flags(uint8_t const *p) {
+		__m512i v = _mm512_maskz_cvtepu8_epi32(0xffff, _mm_loadu_si128(reinterpret_cast< __m128i const * >(p)));
+		return _mm512_test_epi32_mask(v, v);
+	}
+	static void store_flags(uint8_t *p, M m) {
+		__m128i w = _mm512_maskz_cvtepi32_epi8(0xffff, _mm512_maskz_set1_epi32(m, 1));
+		_mm_storeu_si128(reinterpret_cast< __m128i * >(p), w);
+	}
+
+	static F set(float v) { return _mm512_set1_ps(v); }
+	static I set(int32_t v) { return _mm512_set1_epi32(v); }
+	static M mask(bool b) { return M(b ? 0xffff : 0); }
+
+	static F add(F a, F b) { return _mm512_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm512_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm512_mul_ps(a, b); }
+	static I add(I a, I b) { return _mm512_add_epi32(a, b); }
+
+	static M le(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+	static M ge(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+	static M eq(I a, I b) { return _mm512_cmpeq_epi32_mask(a, b); }
+
+	static M and_(M a, M b) { return M(a & b); }
+	static M or_(M a, M b) { return M(a | b); }
+	static M and_not(M a, M b) { return M(a & ~b); }
+
+	static F select(M m, F t, F f) { return _mm512_mask_blend_ps(m, f, t); }
+	static I select(M m, I t, I f) { return _mm512_mask_blend_epi32(m, f, t); }
+	static M select_mask(M m, M t, M f) { return M((m & t) | (~m & f)); }
+};
+#endif
+
+#if defined(__AVX512F__)
+typedef AVX512Lanes WideLanes;
+#elif defined(__AVX2__)
+typedef AVX2Lanes WideLanes;
+#elif defined(__SSE2__) || defined(_M_X64)
+typedef SSE2Lanes WideLanes;
+#else
+typedef ScalarLanes WideLanes;
+#endif
+
+//---------------------------
+
+//advance the ball of matches [match, match + L::Width) by 'dt' (players must already be stepped):
+template< typename L >
+inline void step_ball_lanes(VolleyballLanes const &lanes, size_t match, float dt) {
+	typedef typename L::F F;
+	typedef typename L::I I;
+	typedef typename L::M M;
+
+	F const p1_x = L::load(lanes.p1_x + match);
+	F const p1_y = L::load(lanes.p1_y + match);
+	F const p2_x = L::load(lanes.p2_x + match);
+	F const p2_y = L::load(lanes.p2_y + match);
+	F ball_x = L::load(lanes.ball_x + match);
+	F ball_y = L::load(lanes.ball_y + match);
+	F ball_vel_x = L::load(lanes.ball_vel_x + match);
+	F ball_vel_y = L::load(lanes.ball_vel_y + match);
+	I p1_score = L::load(lanes.p1_score + match);
+	I p2_score = L::load(lanes.p2_score + match);
+	M p1_touch_last = L::load_flags(lanes.p1_touch_last + match);
+	M game_over = L::load_flags(lanes.game_over + match);
+
+	F const zero = L::set(0.0f);
+	F const minus_one = L::set(-1.0f);
+	F const bounce = L::set(VolleyballSim::BounceSpeed);
+	M const yes = L::mask(true);
+	M const no = L::mask(false);
+
+	//update ball's position:
+	ball_y = L::add(ball_y, L::mul(ball_vel_y, L::set(dt)));
+	ball_x = L::add(ball_x, L::mul(ball_vel_x, L::set(dt)));
+
+	//if the ball reached a side wall, reverse the x direction:
+	{
+		M left = L::le(ball_x, L::set(-VolleyballSim::WallX));
+		ball_x = L::select(left, L::set(-VolleyballSim::WallX), ball_x);
+		ball_vel_x = L::select(left, L::mul(ball_vel_x, minus_one), ball_vel_x);
+
+		M right = L::ge(ball_x, L::set(VolleyballSim::WallX));
+		ball_x = L::select(right, L::set(VolleyballSim::WallX), ball_x);
+		ball_vel_x = L::select(right, L::mul(ball_vel_x, minus_one), ball_vel_x);
+	}
+
+	//corner and net-top tests use the ball position from before any player collision:
+	F const ball_pos_x = ball_x;
+	F const ball_pos_y = ball_y;
+
+	F const corner_radius2 = L::set(VolleyballSim::CornerRadius * VolleyballSim::CornerRadius);
+	auto hits_corner = [&](F corner_x, F corner_y) -> M {
+		F dx = L::sub(ball_pos_x, corner_x);
+		F dy = L::sub(ball_pos_y, corner_y);
+		return L::le(L::add(L::mul(dx, dx), L::mul(dy, dy)), corner_radius2);
+	};
+
+	struct Player {
+		F x, y;
+		M is_p1;
+	} const players[2] = {
+		{p1_x, p1_y, yes},
+		{p2_x, p2_y, no},
+	};
+
+	//ball hitting one of the top corners of a player (first hit wins):
+	M hit_corner = no;
+	for (auto const &player : players) {
+		F const top = L::add(player.y, L::set(0.5f));
+		float const offsets[2] = {-0.5f, 0.5f};
+		for (float offset : offsets) {
+			M hit = L::and_not(hits_corner(L::add(player.x, L::set(offset)), top), hit_corner);
+			ball_vel_y = L::select(hit, bounce, ball_vel_y);
+			ball_vel_x = L::select(hit, L::add(ball_vel_x, L::set(offset < 0.0f ? -1.5f : 1.5f)), ball_vel_x);
+			p1_touch_last = L::select_mask(hit, player.is_p1, p1_touch_last);
+			hit_corner = L::or_(hit_corner, hit);
+		}
+	}
+
+	//ball hitting a player's head bounces upward:
+	M hit_top = no;
+	for (auto const &player : players) {
+		M hit = L::and_(
+			L::and_(L::le(ball_y, L::add(player.y, L::set(0.5f))), L::ge(ball_y, L::add(player.y, L::set(0.25f)))),
+			L::and_(L::le(ball_x, L::add(player.x, L::set(0.5f))), L::ge(ball_x, L::sub(player.x, L::set(0.5f))))
+		);
+		hit = L::and_not(hit, L::or_(hit_corner, hit_top));
+		ball_y = L::select(hit, L::add(player.y, L::set(0.85f)), ball_y);
+		ball_vel_y = L::select(hit, bounce, ball_vel_y);
+		p1_touch_last = L::select_mask(hit, player.is_p1, p1_touch_last);
+		hit_top = L::or_(hit_top, hit);
+	}
+
+	//ball hitting a player's side bounces away from the player:
+	M hit_side = no;
+	for (auto const &player : players) {
+		M band = L::and_(L::le(ball_y, L::add(player.y, L::set(0.5f))), L::ge(ball_y, L::sub(player.y, L::set(0.5f))));
+
+		M left = L::and_(band, L::and_(L::le(ball_x, L::sub(player.x, L::set(0.4f))), L::ge(ball_x, L::sub(player.x, L::set(0.85f)))));
+		left = L::and_not(left, L::or_(L::or_(hit_corner, hit_top), hit_side));
+		ball_x = L::select(left, L::sub(player.x, L::set(0.85f)), ball_x);
+		ball_vel_x = L::select(L::and_(left, L::ge(ball_vel_x, zero)), L::mul(ball_vel_x, minus_one), ball_vel_x);
+		p1_touch_last = L::select_mask(left, player.is_p1, p1_touch_last);
+		hit_side = L::or_(hit_side, left);
+
+		M right = L::and_(band, L::and_(L::ge(ball_x, L::add(player.x, L::set(0.4f))), L::le(ball_x, L::add(player.x, L::set(0.85f)))));
+		right = L::and_not(right, L::or_(L::or_(hit_corner, hit_top), hit_side));
+		ball_x = L::select(right, L::add(player.x, L::set(0.85f)), ball_x);
+		ball_vel_x = L::select(L::and_(right, L::le(ball_vel_x, zero)), L::mul(ball_vel_x, minus_one), ball_vel_x);
+		p1_touch_last = L::select_mask(right, player.is_p1, p1_touch_last);
+		hit_side = L::or_(hit_side, right);
+	}
+
+	//scoring resets the ball above player 1:
+	auto serve = [&](M hit) {
+		ball_x = L::select(hit, p1_x, ball_x);
+		ball_y = L::select(hit, L::set(VolleyballSim::ServeY), ball_y);
+		ball_vel_x = L::select(hit, zero, ball_vel_x);
+		ball_vel_y = L::select(hit, zero, ball_vel_y);
+	};
+	I const one = L::set(int32_t(1));
+	I const winning_score = L::set(int32_t(VolleyballSim::WinningScore));
+	auto score_point = [&](M hit, M p1_point) {
+		p1_score = L::select(L::and_(hit, p1_point), L::add(p1_score, one), p1_score);
+		p2_score = L::select(L::and_not(hit, p1_point), L::add(p2_score, one), p2_score);
+		M won = L::or_(L::eq(p1_score, winning_score), L::eq(p2_score, winning_score));
+		game_over = L::or_(game_over, L::and_(hit, won));
+	};
+
+	//touching the net is a point for whoever didn't touch the ball last:
+	{ //top corner of the net:
+		M hit = hits_corner(L::set(lanes.net_x - 0.5f), L::set(lanes.net_y + 0.5f));
+		serve(hit);
+		score_point(hit, L::and_not(yes, p1_touch_last));
+	}
+	F const net_top = L::set(lanes.net_y + 1.0f);
+	{ //net's left wall:
+		M hit = L::and_(L::le(ball_y, net_top),
+			L::and_(L::le(ball_x, L::set(lanes.net_x - 0.0f)), L::ge(ball_x, L::set(lanes.net_x - 0.40f))));
+		serve(hit);
+		score_point(hit, L::and_not(yes, p1_touch_last));
+	}
+	{ //net's right wall:
+		M hit = L::and_(L::le(ball_y, net_top),
+			L::and_(L::ge(ball_x, L::set(lanes.net_x + 0.0f)), L::le(ball_x, L::set(lanes.net_x + 0.40f))));
+		serve(hit);
+		score_point(hit, L::and_not(yes, p1_touch_last));
+	}
+	{ //if the ball reached the floor, the point goes to the player on the other side:
+		M hit = L::le(ball_y, L::set(0.35f));
+		score_point(hit, L::ge(ball_x, zero));
+		serve(hit);
+	}
+
+	//gravity (the ball freezes once the game is over):
+	ball_vel_y = L::select(game_over, ball_vel_y, L::add(ball_vel_y, L::set(VolleyballSim::Gravity * dt)));
+
+	L::store(lanes.ball_x + match, ball_x);
+	L::store(lanes.ball_y + match, ball_y);
+	L::store(lanes.ball_vel_x + match, ball_vel_x);
+	L::store(lanes.ball_vel_y + match, ball_vel_y);
+	L::store(lanes.p1_score + match, p1_score);
+	L::store(lanes.p2_score + match, p2_score);
+	L::store_flags(lanes.p1_touch_last + match, p1_touch_last);
+	L::store_flags(lanes.game_over + match, game_over);
+}
@@ -0,0 +1,94 @@
+#include "VolleyballSim.hpp"
+#include "VolleyballKernel.hpp"
+#include "CollisionWorld.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float VolleyballSim::Gravity;
+constexpr float VolleyballSim::PlayerSpeed;
+constexpr float VolleyballSim::JumpSpeed;
+constexpr float VolleyballSim::BounceSpeed;
+constexpr float VolleyballSim::CornerRadius;
+constexpr float VolleyballSim::BallRadius;
+constexpr float VolleyballSim::PlayerHalfSize;
+constexpr float VolleyballSim::WallX;
+constexpr float VolleyballSim::ServeY;
+constexpr int VolleyballSim::WinningScore;
+constexpr float VolleyballSim::MaxBallTravel;
+constexpr uint32_t VolleyballSim::MaxSubsteps;
+
+uint32_t VolleyballSim::substeps_for(float ball_vel_x, float ball_vel_y, float dt) {
+	//(gravity can speed the ball up during the step, so allow for that too)
+	float speed = std::sqrt(ball_vel_x * ball_vel_x + ball_vel_y * ball_vel_y) + std::abs(Gravity) * dt;
+	float steps = std::ceil(speed * dt / MaxBallTravel);
+	if (!(steps >= 1.0f)) return 1; //(also catches NaN)
+	return uint32_t(std::min(steps, float(MaxSubsteps)));
+}
+
+void VolleyballSim::step(float dt, Inputs const &inputs, CollisionWorld const *world) {
+	uint32_t substeps = substeps_for(ball_vel_x, ball_vel_y, dt);
+	float sub_dt = dt / float(substeps);
+	for (uint32_t i = 0; i < substeps; ++i) {
+		step_once(sub_dt, inputs, world);
+	}
+}
+
+void VolleyballSim::step_once(float dt, Inputs const &inputs, CollisionWorld const *world) {
+	step_player_lane(p1.x, p1.y, p1.vel_y, p1.can_jump, p1.jumped, dt, -9.5f, -0.55f, inputs.p1_left, inputs.p1_right, inputs.p1_jump);
+	step_player_lane(p2.x, p2.y, p2.vel_y, p2.can_jump, p2.jumped, dt, 0.55f, 9.5f, inputs.p2_left, inputs.p2_right, inputs.p2_jump);
+	if (world) {
+		for (Player *player : {&p1, &p2}) {
+			bool landed = false;
+			world->collide_box(player->x, player->y, PlayerHalfSize, PlayerHalfSize, player->vel_y, &landed);
+			if (landed) player->can_jump = true;
+		}
+	}
+
+	//NOTE: players' horizontal motion does not nudge the ball on contact
+	// (the original game loop cleared its 'moving' flags before the collision tests).
+
+	//the ball goes through the same kernel VolleyballBatch uses, one lane wide:
+	int32_t scores[2] = {p1_score, p2_score};
+	uint8_t flags[2] = {p1_touch_last, game_over};
+
+	VolleyballLanes lanes;
+	lanes.p1_x = &p1.x;
+	lanes.p1_y = &p1.y;
+	lanes.p2_x = &p2.x;
+	lanes.p2_y = &p2.y;
+	lanes.ball_x = &ball_x;
+	lanes.ball_y = &ball_y;
+	lanes.ball_vel_x = &ball_vel_x;
+	lanes.ball_vel_y = &ball_vel_y;
+	lanes.p1_score = &scores[0];
+	lanes.p2_score = &scores[1];
+	lanes.p1_touch_last = &flags[0];
+	lanes.game_over = &flags[1];
+	lanes.net_x = net_x;
+	lanes.net_y = net_y;
+	float const before_x = ball_x;
+	float const before_y = ball_y;
+	step_ball_lanes< ScalarLanes >(lanes, 0, dt);
+
+	//(the ball still bounces off the kernel's walls at +/- WallX, inside the scenery's side walls, as the game was tuned)
+	if (world) {
+		//sweep the ball along its move, so it can't pass through an obstacle between one position and the next:
+		// (unless the kernel served it, in which case it didn't travel)
+		bool served = (scores[0] != p1_score || scores[1] != p2_score);
+		float t, nx, ny;
+		if (!served && world->sweep_ball(before_x, before_y, ball_x - before_x, ball_y - before_y, BallRadius, &t, &nx, &ny)) {
+			float dx = ball_x - before_x;
+			float dy = ball_y - before_y;
+			ball_x = before_x;
+			ball_y = before_y;
+			world->move_ball(ball_x, ball_y, dx, dy, ball_vel_x, ball_vel_y, BallRadius);
+		}
+		world->collide_ball(ball_x, ball_y, ball_vel_x, ball_vel_y, BallRadius);
+	}
+
+	p1_score = scores[0];
+	p2_score = scores[1];
+	p1_touch_last = (flags[0] != 0);
+	game_over = (flags[1] != 0);
+}
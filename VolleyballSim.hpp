@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+struct CollisionWorld;
+
+//VolleyballSim holds the complete state of a cube volleyball match and advances it in fixed steps.
+// It has no SDL or OpenGL dependency, so it can be stepped headless (bots, replays, regression checks).
+
+//The whole game may be 3d, but it is bound by 2d controls:
+// sim 'x' coordinates correspond to an object's y position
+// sim 'y' coordinates correspond to an object's z position
+
+struct VolleyballSim {
+	//per-step snapshot of both players' controls:
+	struct Inputs {
+		bool p1_left = false;
+		bool p1_right = false;
+		bool p1_jump = false;
+		bool p2_left = false;
+		bool p2_right = false;
+		bool p2_jump = false;
+
+		//compact form (one bit per control) for recording / sending over the wire:
+		uint8_t to_bits() const {
+			return uint8_t(
+				  (p1_left ? 0x01 : 0) | (p1_right ? 0x02 : 0) | (p1_jump ? 0x04 : 0)
+				| (p2_left ? 0x08 : 0) | (p2_right ? 0x10 : 0) | (p2_jump ? 0x20 : 0)
+			);
+		}
+		static Inputs from_bits(uint8_t bits) {
+			Inputs inputs;
+			inputs.p1_left = (bits & 0x01) != 0;
+			inputs.p1_right = (bits & 0x02) != 0;
+			inputs.p1_jump = (bits & 0x04) != 0;
+			inputs.p2_left = (bits & 0x08) != 0;
+			inputs.p2_right = (bits & 0x10) != 0;
+			inputs.p2_jump = (bits & 0x20) != 0;
+			return inputs;
+		}
+	};
+
+	struct Player {
+		float x = 0.0f;
+		float y = 0.5f;
+		//players can only exert vertical velocity (horizontal motion is fixed by the inputs):
+		float vel_y = 0.0f;
+		bool can_jump = true;
+		bool jumped = false;
+	};
+
+	Player p1;
+	Player p2;
+
+	float ball_x = 0.0f;
+	float ball_y = 4.0f;
+	float ball_vel_x = 0.0f;
+	float ball_vel_y = 0.0f;
+
+	//net is static; position comes from the scene:
+	float net_x = 0.0f;
+	float net_y = 0.0f;
+
+	int p1_score = 0;
+	int p2_score = 0;
+
+	bool p1_touch_last = false;
+	bool game_over = false;
+
+	//advance the match by 'dt' seconds (the game was tuned for dt = 1/60):
+	// a fast ball is advanced in several sub-steps, so it never skips past the net or a player.
+	// 'world' holds static obstacles (walls, scenery) for the ball and players to collide with, if any;
+	// it's the court, not part of the match, so it stays out of the state above (which snapshots, replays,
+	// and rollback copy as raw bytes). The ball is always kept within the built-in walls at +/- WallX as well.
+	// (VolleyballBatch only uses the built-in walls)
+	void step(float dt, Inputs const &inputs, CollisionWorld const *world = nullptr);
+
+	//sub-steps needed for a ball with this velocity to travel at most MaxBallTravel per sub-step:
+	static uint32_t substeps_for(float ball_vel_x, float ball_vel_y, float dt);
+
+	//tuning constants:
+	static constexpr float Gravity = -10.0f;
+	static constexpr float PlayerSpeed = 6.0f; //horizontal units per second
+	static constexpr float JumpSpeed = 6.0f;
+	static constexpr float BounceSpeed = 8.0f;
+	static constexpr float CornerRadius = 0.35f;
+	static constexpr float BallRadius = 0.35f;
+	static constexpr float PlayerHalfSize = 0.5f; //players are 1x1 boxes
+	static constexpr float WallX = 9.15f;
+	static constexpr float ServeY = 4.0f;
+	static constexpr int WinningScore = 10;
+	//(less than the thinnest band the ball is tested against -- the top of a player's head -- so no test is skipped)
+	static constexpr float MaxBallTravel = 0.24f;
+	static constexpr uint32_t MaxSubsteps = 64;
+
+	//internals:
+	void step_once(float dt, Inputs const &inputs, CollisionWorld const *world = nullptr);
+};
@@ -1,8 +1,16 @@
 #include "load_save_png.hpp"
 #include "GL.hpp"
+#include "AssetLoader.hpp"
+#include "CollisionWorld.hpp"
+#include "FileWatcher.hpp"
 #include "Meshes.hpp"
 #include "Scene.hpp"
 #include "read_chunk.hpp"
+#include "MappedFile.hpp"
+#include "VolleyballSim.hpp"
+#include "Replay.hpp"
+#include "NetSession.hpp"
+#include "SnapshotRing.hpp"
 #include <math.h>
 
 #include <SDL.h>
@@ -10,10 +18,15 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
-#include <fstream>
+#include <thread>
 
 static GLuint compile_shader(GLenum type, std::string const &source);
 static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader);
@@ -23,8 +36,230 @@ int main(int argc, char **argv) {
 	struct {
 		std::string title = "Game2: Scene";
 		glm::uvec2 size = glm::uvec2(640, 480);
+		float sim_rate = 60.0f; //simulation steps per second (independent of display refresh)
+		float max_catch_up = 0.25f; //most time (seconds) simulated in one frame after a stall
+		float max_fps = 240.0f; //render rate cap, only used if vsync isn't available
+		float speed = 1.0f; //simulated seconds per real second
+		std::string record; //if set, save a replay of the session here on exit
+		std::string replay; //if set, play back this replay instead of reading the keyboard
+		bool headless = false; //play back 'replay' as fast as possible, without a window
+		float load_budget = 0.004f; //most time (seconds) per frame spent finishing background loads
+		float rewind_seconds = 10.0f; //how far back holding backspace can rewind the match
+		//networked play (see NetSession); 'latency', 'jitter', and 'loss' are for testing on one machine:
+		bool net = false;
+		NetSession::Config net_config;
 	} config;
 
+	//read all of 'value' as a finite number; throws (naming 'option' and the bad value) if it isn't one:
+	auto parse_float = [](std::string const &option, std::string const &value) -> float {
+		float number = 0.0f;
+		size_t used = 0;
+		try {
+			number = std::stof(value, &used);
+		} catch (std::exception &) {
+			used = 0; //(not a number at all, or out of float's range)
+		}
+		if (used == 0 || used != value.size() || !std::isfinite(number)) {
+			throw std::runtime_error(option + " expects a number, not '" + value + "'.");
+		}
+		return number;
+	};
+	//(same, for a UDP port; rejects anything that wouldn't fit, rather than letting it wrap)
+	auto parse_port = [&parse_float](std::string const &option, std::string const &value) -> uint16_t {
+		float number = parse_float(option, value);
+		if (!(number >= 1.0f && number <= 65535.0f && number == std::floor(number))) {
+			throw std::runtime_error(option + " needs a port from 1 to 65535, not '" + value + "'.");
+		}
+		return uint16_t(number);
+	};
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--record" && i + 1 < argc) {
+				config.record = argv[++i];
+			} else if (arg == "--replay" && i + 1 < argc) {
+				config.replay = argv[++i];
+			} else if (arg == "--speed" && i + 1 < argc) {
+				std::string value = argv[++i];
+				config.speed = parse_float("--speed", value);
+				if (!(config.speed > 0.0f)) throw std::runtime_error("--speed must be positive, not '" + value + "'.");
+			} else if (arg == "--headless") {
+				config.headless = true;
+			} else if (arg == "--host" && i + 1 < argc) {
+				config.net = true;
+				config.net_config.port = parse_port("--host", argv[++i]);
+			} else if (arg == "--connect" && i + 1 < argc) {
+				std::string address = argv[++i];
+				size_t colon = address.rfind(':');
+				if (colon == std::string::npos) {
+					throw std::runtime_error("--connect needs an address and port (e.g., 127.0.0.1:4000), not '" + address + "'.");
+				}
+				config.net = true;
+				config.net_config.peer_host = address.substr(0, colon);
+				config.net_config.peer_port = parse_port("--connect", address.substr(colon + 1));
+			} else if (arg == "--latency" && i + 1 < argc) {
+				std::string value = argv[++i];
+				config.net_config.latency = parse_float("--latency", value) / 1000.0f;
+				if (config.net_config.latency < 0.0f) throw std::runtime_error("--latency can't be negative, not '" + value + "'.");
+			} else if (arg == "--jitter" && i + 1 < argc) {
+				std::string value = argv[++i];
+				config.net_config.jitter = parse_float("--jitter", value) / 1000.0f;
+				if (config.net_config.jitter < 0.0f) throw std::runtime_error("--jitter can't be negative, not '" + value + "'.");
+			} else if (arg == "--loss" && i + 1 < argc) {
+				std::string value = argv[++i];
+				config.net_config.loss = parse_float("--loss", value) / 100.0f;
+				if (!(config.net_config.loss >= 0.0f && config.net_config.loss <= 1.0f)) throw std::runtime_error("--loss needs a percentage from 0 to 100, not '" + value + "'.");
+			} else {
+				std::cerr << "Usage:\n\t" << argv[0] << " [--record <file>] [--replay <file> [--speed <multiplier>] [--headless]]"
+					<< "\n\t" << argv[0] << " (--host <port> | --connect <address>:<port>) [--latency <ms>] [--jitter <ms>] [--loss <percent>]" << std::endl;
+				return 1;
+			}
+		}
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+	if (config.net && (config.replay != "" || config.record != "" || config.headless)) {
+		std::cerr << "Networked play can't be combined with --record, --replay, or --headless." << std::endl;
+		return 1;
+	}
+
+	Replay replay;
+	if (config.replay != "") {
+		try {
+			replay.load(config.replay);
+		} catch (std::exception &e) {
+			std::cerr << "ERROR: " << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	//objects placed by "scene.blob":
+	struct Placement {
+		NameID name;
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	typedef std::shared_ptr< std::vector< Placement > > Placements;
+	auto read_scene = [](std::string const &filename, MappedFile::Access access) -> Placements {
+		Placements placements = std::make_shared< std::vector< Placement > >();
+
+		MappedFile file(filename, access);
+		ChunkReader reader(file.data, file.size);
+
+		ChunkSpan< char > strings;
+		//read strings chunk:
+		reader.read("str0", &strings);
+
+		{ //read scene chunk:
+			struct SceneEntry {
+				uint32_t name_begin, name_end;
+				glm::vec3 position;
+				glm::quat rotation;
+				glm::vec3 scale;
+			};
+			static_assert(sizeof(SceneEntry) == 48, "Scene entry should be packed");
+
+			ChunkSpan< SceneEntry > data;
+			reader.read("scn0", &data);
+
+			for (size_t i = 0; i < data.size(); ++i) {
+				SceneEntry entry = data[i];
+				if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+					throw std::runtime_error("index entry has out-of-range name begin/end");
+				}
+				NameID name(reinterpret_cast< char const * >(strings.bytes) + entry.name_begin, entry.name_end - entry.name_begin);
+				placements->emplace_back(Placement{name, entry.position, entry.rotation, entry.scale});
+			}
+		}
+		return placements;
+	};
+
+	//what each object placed by the scene is to the game:
+	enum class Role { Player, Net, Floor, Ball, Wall, Scenery };
+	auto role_of = [](NameID name) -> Role {
+		if (name == NameID("Cube") ||
+			name == NameID("Cube.001")){
+			return Role::Player;
+		}
+		else if (name == NameID("Cube.002") ){
+			return Role::Net;
+		}
+		else if (name == NameID("Plane")){
+			return Role::Floor;
+		}
+		else if (name == NameID("Sphere")){
+			return Role::Ball;
+		}
+		else if (name == NameID("Cube.005")){
+			return Role::Wall;
+		}
+		else{
+			return Role::Scenery;
+		}
+	};
+
+	//the simulation's static obstacles: the scenery that cuts the plane of play (world x = 0),
+	// as boxes (from mesh bounds) in sim coordinates (sim x = world y, sim y = world z):
+	CollisionWorld world;
+	auto build_world = [&world, &role_of](std::vector< Placement > const &placements, std::function< Mesh const &(NameID) > const &mesh_for) {
+		world.clear();
+		for (auto const &p : placements) {
+			Role role = role_of(p.name);
+			if (role != Role::Wall && role != Role::Scenery) continue;
+			Mesh const &mesh = mesh_for(p.name);
+			//world-space box around the mesh's (object-space) box:
+			glm::mat3 linear = glm::mat3_cast(p.rotation);
+			linear[0] *= p.scale.x;
+			linear[1] *= p.scale.y;
+			linear[2] *= p.scale.z;
+			glm::vec3 center = p.position + linear * (0.5f * (mesh.max + mesh.min));
+			glm::vec3 half = 0.5f * (mesh.max - mesh.min);
+			glm::vec3 radius = glm::abs(linear[0]) * half.x + glm::abs(linear[1]) * half.y + glm::abs(linear[2]) * half.z;
+			if (center.x - radius.x > 0.0f || center.x + radius.x < 0.0f) continue;
+
+			CollisionWorld::Box box;
+			box.min_x = center.y - radius.y;
+			box.max_x = center.y + radius.y;
+			box.min_y = center.z - radius.z;
+			box.max_y = center.z + radius.z;
+			//(walls reach up forever, so a high ball can't sail out of the court)
+			if (role == Role::Wall) box.max_y = std::numeric_limits< float >::infinity();
+			world.add(box);
+		}
+		world.build();
+	};
+
+	if (config.headless) { //no window, just run the simulation:
+		if (config.replay == "") {
+			std::cerr << "--headless needs a replay to play (--replay <file>)." << std::endl;
+			return 1;
+		}
+		VolleyballSim sim = replay.initial;
+		CollisionWorld const *scenery = nullptr;
+		try { //collide with the same scenery the game would have:
+			Placements placements = read_scene("scene.blob", MappedFile::Map);
+			Meshes::Parsed parsed = Meshes::parse("meshes.blob");
+			build_world(*placements, [&parsed](NameID name) -> Mesh const & {
+				for (auto const &entry : parsed.entries) {
+					if (entry.id == name) return entry.mesh;
+				}
+				throw std::runtime_error("Looking up mesh that doesn't exist.");
+			});
+			scenery = &world;
+		} catch (std::exception &e) {
+			std::cerr << "WARNING: no scenery to collide with (" << e.what() << "); using the built-in walls." << std::endl;
+		}
+		auto before = std::chrono::steady_clock::now();
+		replay.play(&sim, scenery);
+		float seconds = std::chrono::duration< float >(std::chrono::steady_clock::now() - before).count();
+		std::cout << "Replayed " << replay.inputs.size() << " steps (" << replay.inputs.size() * replay.dt << " game seconds) in " << seconds << " seconds." << std::endl;
+		printf("Final Score: p1 %i | p2 %i%s\n", sim.p1_score, sim.p2_score, sim.game_over ? " (game over)" : "");
+		return 0;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -75,10 +310,12 @@ int main(int argc, char **argv) {
 	#endif
 
 	//Set VSYNC + Late Swap (prevents crazy FPS):
+	bool vsync = true;
 	if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
 		if (SDL_GL_SetSwapInterval(1) != 0) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
+			vsync = false;
 		}
 	}
 
@@ -91,16 +328,19 @@ int main(int argc, char **argv) {
 	GLuint program = 0;
 	GLuint program_Position = 0;
 	GLuint program_Normal = 0;
-	GLuint program_mvp = 0;
-	GLuint program_itmv = 0;
-	GLuint program_to_light = 0;
+	//instanced variant (same attribute locations, so it can draw from the same vertex arrays):
+	GLuint instanced_program = 0;
+	GLuint instanced_program_base = 0;
 	{ //compile shader program:
+		//(uniform blocks are filled by Scene::render(); see Scene::FrameBlock and Scene::ObjectBlock)
 		GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER,
 			"#version 330\n"
-			"uniform mat4 mvp;\n"
-			"uniform mat3 itmv;\n"
-			"in vec4 Position;\n"
-			"in vec3 Normal;\n"
+			"layout(std140) uniform Object {\n"
+			"	mat4 mvp;\n"
+			"	mat3 itmv;\n"
+			"};\n"
+			"layout(location = 0) in vec4 Position;\n"
+			"layout(location = 1) in vec3 Normal;\n"
 			"out vec3 normal;\n"
 			"void main() {\n"
 			"	gl_Position = mvp * Position;\n"
@@ -110,12 +350,22 @@ int main(int argc, char **argv) {
 
 		GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER,
 			"#version 330\n"
-			"uniform vec3 to_light;\n"
+			"layout(std140) uniform Frame {\n"
+			"	mat4 world_to_clip;\n"
+			"	mat4 world_to_camera;\n"
+			"	vec4 light_direction[8];\n"
+			"	vec4 light_intensity[8];\n"
+			"	int light_count;\n"
+			"};\n"
 			"in vec3 normal;\n"
 			"out vec4 fragColor;\n"
 			"void main() {\n"
-			"	float light = max(0.0, dot(normalize(normal), to_light));\n"
-			"	fragColor = vec4(light * vec3(1.0, 1.0, 1.0), 1.0);\n"
+			"	vec3 n = normalize(normal);\n"
+			"	vec3 light = vec3(0.0);\n"
+			"	for (int i = 0; i < light_count; ++i) {\n"
+			"		light += light_intensity[i].rgb * max(0.0, dot(n, light_direction[i].xyz));\n"
+			"	}\n"
+			"	fragColor = vec4(light, 1.0);\n"
 			"}\n"
 		);
 
@@ -127,27 +377,48 @@ int main(int argc, char **argv) {
 		program_Normal = glGetAttribLocation(program, "Normal");
 		if (program_Normal == -1U) throw std::runtime_error("no attribute named Normal");
 
-		//look up uniform locations:
-		program_mvp = glGetUniformLocation(program, "mvp");
-		if (program_mvp == -1U) throw std::runtime_error("no uniform named mvp");
-		program_itmv = glGetUniformLocation(program, "itmv");
-		if (program_itmv == -1U) throw std::runtime_error("no uniform named itmv");
+		//hook up uniform blocks:
+		GLuint program_Frame = glGetUniformBlockIndex(program, "Frame");
+		if (program_Frame == GL_INVALID_INDEX) throw std::runtime_error("no uniform block named Frame");
+		glUniformBlockBinding(program, program_Frame, Scene::FrameBinding);
+		GLuint program_Object = glGetUniformBlockIndex(program, "Object");
+		if (program_Object == GL_INVALID_INDEX) throw std::runtime_error("no uniform block named Object");
+		glUniformBlockBinding(program, program_Object, Scene::ObjectBinding);
+
+		//instanced vertex shader reads mvp / itmv from Scene's per-instance buffer texture:
+		GLuint instanced_vertex_shader = compile_shader(GL_VERTEX_SHADER,
+			"#version 330\n"
+			"uniform samplerBuffer instances;\n"
+			"uniform int base;\n"
+			"layout(location = 0) in vec4 Position;\n"
+			"layout(location = 1) in vec3 Normal;\n"
+			"out vec3 normal;\n"
+			"void main() {\n"
+			"	int i = base + 7 * gl_InstanceID;\n"
+			"	mat4 mvp = mat4(texelFetch(instances, i), texelFetch(instances, i+1), texelFetch(instances, i+2), texelFetch(instances, i+3));\n"
+			"	mat3 itmv = mat3(texelFetch(instances, i+4).xyz, texelFetch(instances, i+5).xyz, texelFetch(instances, i+6).xyz);\n"
+			"	gl_Position = mvp * Position;\n"
+			"	normal = itmv * Normal;\n"
+			"}\n"
+		);
+
+		instanced_program = link_program(fragment_shader, instanced_vertex_shader);
+
+		instanced_program_base = glGetUniformLocation(instanced_program, "base");
+		if (instanced_program_base == -1U) throw std::runtime_error("no uniform named base");
+		GLuint instanced_program_instances = glGetUniformLocation(instanced_program, "instances");
+		if (instanced_program_instances == -1U) throw std::runtime_error("no uniform named instances");
+		GLuint instanced_program_Frame = glGetUniformBlockIndex(instanced_program, "Frame");
+		if (instanced_program_Frame == GL_INVALID_INDEX) throw std::runtime_error("no uniform block named Frame");
+		glUniformBlockBinding(instanced_program, instanced_program_Frame, Scene::FrameBinding);
 
-		program_to_light = glGetUniformLocation(program, "to_light");
-		if (program_to_light == -1U) throw std::runtime_error("no uniform named to_light");
+		glUseProgram(instanced_program);
+		glUniform1i(instanced_program_instances, Scene::InstanceTextureUnit);
 	}
 
 	//------------ meshes ------------
 
 	Meshes meshes;
-
-	{ //add meshes to database:
-		Meshes::Attributes attributes;
-		attributes.Position = program_Position;
-		attributes.Normal = program_Normal;
-
-		meshes.load("meshes.blob", attributes);
-	}
 	
 	//------------ scene ------------
 
@@ -158,129 +429,280 @@ int main(int argc, char **argv) {
 	scene.camera.near = 0.01f;
 	//(transform will be handled in the update function below)
 
-	//add some objects from the mesh library:
-	auto add_object = [&](std::string const &name, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) -> Scene::Object & {
+	//the light rides along with the camera, shining from slightly above it:
+	Scene::Light &light = scene.lights.emplace();
+	light.transform.set_parent(&scene.camera.transform);
+	light.transform.set_rotation(glm::angleAxis(-std::atan2(1.0f, 10.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
+
+	//point an object at a mesh from the library:
+	auto set_mesh = [&](Scene::Object &object, NameID name) {
 		Mesh const &mesh = meshes.get(name);
-		scene.objects.emplace_back();
-		Scene::Object &object = scene.objects.back();
-		object.transform.position = position;
-		object.transform.rotation = rotation;
-		object.transform.scale = scale;
 		object.vao = mesh.vao;
 		object.start = mesh.start;
 		object.count = mesh.count;
+		object.index_type = mesh.index_type;
+		object.base_vertex = mesh.base_vertex;
+		object.dequantize = mesh.dequantize;
+		object.min = mesh.min;
+		object.max = mesh.max;
 		object.program = program;
-		object.program_mvp = program_mvp;
-		object.program_itmv = program_itmv;
-		return object;
+		object.instanced_program = instanced_program;
+		object.instanced_program_base = instanced_program_base;
+	};
+
+	//objects placed by scene.blob, in file order (kept so a changed scene.blob can be diffed against them):
+	struct SceneItem {
+		NameID name;
+		Pool< Scene::Object >::Handle handle;
+		Scene::Object *object;
+	};
+	std::vector< SceneItem > scene_items;
+
+	//add some objects from the mesh library:
+	auto add_object = [&](NameID name, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) -> Scene::Object & {
+		meshes.get(name); //(throws before adding anything if there's no such mesh)
+		SceneItem item;
+		item.name = name;
+		item.object = &scene.objects.emplace(&item.handle);
+		item.object->transform.set_position(position);
+		item.object->transform.set_rotation(rotation);
+		item.object->transform.set_scale(scale);
+		set_mesh(*item.object, name);
+		scene_items.emplace_back(item);
+		return *item.object;
 	};
 
 
 	// our tree stack here is our robot arm
 	std::vector< Scene::Object * > players;
-	Scene::Object *net;
-	Scene::Object *floor;
-	Scene::Object *ball;
+	Scene::Object *net = nullptr;
+	Scene::Object *floor = nullptr;
+	Scene::Object *ball = nullptr;
 	std::vector< Scene::Object * > walls;
 
+	//set once the scene has finished loading (until then, frames are drawn but the game doesn't run):
+	bool scene_loaded = false;
 
-	{ //read objects to add from "scene.blob":
-		std::ifstream file("scene.blob", std::ios::binary);
+	//match state lives in the (SDL/GL-free) simulation; objects just mirror it:
+	VolleyballSim sim;
 
-		std::vector< char > strings;
-		//read strings chunk:
-		read_chunk(file, "str0", &strings);
+	//simulation clock:
+	float const sim_dt = (config.replay != "" ? replay.dt : 1.0f / config.sim_rate);
+	VolleyballSim previous_sim = sim; //for interpolating between steps when drawing
+	float accumulator = 0.0f; //real time not yet simulated
+	auto previous_time = std::chrono::steady_clock::now();
 
-		{ //read scene chunk, add meshes to scene:
-			struct SceneEntry {
-				uint32_t name_begin, name_end;
-				glm::vec3 position;
-				glm::quat rotation;
-				glm::vec3 scale;
-			};
-			static_assert(sizeof(SceneEntry) == 48, "Scene entry should be packed");
+	size_t replay_step = 0; //next step to play back from 'replay'
 
-			std::vector< SceneEntry > data;
-			read_chunk(file, "scn0", &data);
+	//recent states, for rewinding (not in networked play, where the match belongs to both players):
+	uint32_t sim_frame = 0; //steps taken since the match started
+	SnapshotRing< VolleyballSim > history(size_t(config.rewind_seconds / sim_dt) + 1);
 
-			for (auto const &entry : data) {
-				if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
-					throw std::runtime_error("index entry has out-of-range name begin/end");
-				}
-				std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+	Replay recording;
+	recording.dt = sim_dt;
 
-				if (name == "Cube" ||
-					name == "Cube.001"){
-					players.emplace_back( &add_object(name, entry.position, entry.rotation, entry.scale) );
-				}
-				else if (name == "Cube.002" ){
-					net = &add_object(name, entry.position, entry.rotation, entry.scale);
-				}
-				else if (name == "Plane"){
-					floor = &add_object(name, entry.position, entry.rotation, entry.scale);
-				}
-				else if (name == "Sphere"){
-					ball = &add_object(name, entry.position, entry.rotation, entry.scale);
-				}
-				else{
-					walls.emplace_back( &add_object(name, entry.position, entry.rotation, entry.scale) );
-				}
-			}
-		}
-	}
+	//networked play starts once both sides have the scene (which gives the starting state):
+	std::unique_ptr< NetSession > session;
+	bool net_connected = false;
+	uint32_t rollbacks_seen = 0;
 
-	glm::vec2 mouse = glm::vec2(0.0f, 0.0f); //mouse position in [-1,1]x[-1,1] coordinates
+	//------------ asset loading ------------
 
-	struct {
-		float radius = 15.0f;
-		float elevation = 0.3f;
-		float azimuth = 0.0f;
-		glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
-	} camera;
+	//files are read and checked in the background; GL uploads and scene setup happen at the top of each frame:
+	AssetLoader loader;
 
-	bool p1_right = false;
-	bool p1_left = false;
-	bool p2_right = false;
-	bool p2_left = false;
+	Meshes::Attributes attributes;
+	attributes.Position = program_Position;
+	attributes.Normal = program_Normal;
 
-	bool p1_can_jump = true;
-	bool p2_can_jump = true;
-	bool p1_jumped = false;
-	bool p2_jumped = false;
+	//re-point every object at its (possibly moved, or changed) mesh:
+	auto refresh_meshes = [&]() {
+		for (auto &item : scene_items) {
+			try {
+				set_mesh(*item.object, item.name);
+			} catch (std::exception &) {
+				item.object->count = 0; //(mesh is gone; draw nothing)
+			}
+		}
+	};
 
-	float p1_c1_x, p1_c1_y;
-	float p1_c2_x, p1_c2_y;
-	float p2_c1_x, p2_c1_y;
-	float p2_c2_x, p2_c2_y;
-	float net_c_x, net_c_y;
+	//bring the scene in line with 'placements': objects already placed are matched up (by name, in order)
+	// and moved; new ones are added; ones no longer placed are removed -- except players, net, and ball,
+	// which the game needs. (The simulation isn't touched, so the match carries on where it was.)
+	std::vector< Placement > placed; //(as last applied; the world is rebuilt from it if meshes change)
+	auto apply_scene = [&](std::vector< Placement > const &placements) {
+		std::vector< bool > matched(scene_items.size(), false);
+		size_t existing = scene_items.size();
+		for (auto const &p : placements) {
+			//first not-yet-matched object with this name (scenes are small, so a linear search is fine):
+			size_t i = 0;
+			while (i < existing && (matched[i] || scene_items[i].name != p.name)) ++i;
+			if (i < existing) {
+				matched[i] = true;
+				Scene::Transform &transform = scene_items[i].object->transform;
+				//(only moved objects are touched, so unmoved ones keep their cached world matrices)
+				if (transform.position() != p.position) transform.set_position(p.position);
+				if (transform.rotation() != p.rotation) transform.set_rotation(p.rotation);
+				if (transform.scale() != p.scale) transform.set_scale(p.scale);
+				continue;
+			}
 
-	float ball_pos_x, ball_pos_y;
-	float distance;
+			Scene::Object *object = &add_object(p.name, p.position, p.rotation, p.scale);
+			switch (role_of(p.name)) {
+				case Role::Player: players.emplace_back(object); break;
+				case Role::Net: net = object; break;
+				case Role::Floor: floor = object; break;
+				case Role::Ball: ball = object; break;
+				case Role::Wall:
+				case Role::Scenery: walls.emplace_back(object); break;
+			}
+		}
 
-	//booleans to reduce unnecessary calculations
-	bool hit_corner = false;
-	bool hit_top = false;
-	bool hit_side = false;
+		//remove objects that are no longer placed:
+		std::vector< SceneItem > kept;
+		for (size_t i = 0; i < scene_items.size(); ++i) {
+			SceneItem const &item = scene_items[i];
+			if (i >= existing || matched[i]) {
+				kept.emplace_back(item);
+			} else if (std::find(players.begin(), players.end(), item.object) != players.end() || item.object == net || item.object == ball) {
+				std::cerr << "WARNING: scene no longer has one of the game's objects; keeping it." << std::endl;
+				kept.emplace_back(item);
+			} else {
+				if (item.object == floor) floor = nullptr;
+				walls.erase(std::remove(walls.begin(), walls.end(), item.object), walls.end());
+				scene.objects.erase(item.handle);
+			}
+		}
+		scene_items = kept;
 
-	//whole game may be 3d, but is bound by 2d controls
-	//x coordinates correspond to an objects y position
-	//y coordinates correspond to an objects z position 
+		if (players.size() < 2 || !net || !ball) {
+			throw std::runtime_error("scene.blob is missing players, net, or ball");
+		}
+		//(the simulation needs to know where the net and the other obstacles are)
+		sim.net_x = net->transform.position()[1];
+		sim.net_y = net->transform.position()[2];
+		build_world(placements, [&meshes](NameID name) -> Mesh const & { return meshes.get(name); });
+		placed = placements;
+	};
 
-	//player 1 and 2 can only exert vertical velocity (horizontal velocity is fixed by the users)
-	float p1_vel_y = 0.0f;
-	float p2_vel_y = 0.0f;
+	//add meshes to database:
+	loader.load([&meshes, &attributes]() -> AssetLoader::Finish {
+		std::shared_ptr< Meshes::Parsed > parsed = std::make_shared< Meshes::Parsed >(Meshes::parse("meshes.blob"));
+		return [&meshes, &attributes, parsed]() {
+			meshes.upload(*parsed, attributes);
+		};
+	});
+
+	//add objects to scene:
+	// (the loader finishes loads in order, so the meshes are in the database by the time objects are added)
+	loader.load([&]() -> AssetLoader::Finish {
+		Placements placements = read_scene("scene.blob", MappedFile::Map);
+		return [&, placements]() {
+			apply_scene(*placements);
+
+			sim.p1.x = players[0]->transform.position()[1];
+			sim.p1.y = players[0]->transform.position()[2];
+			sim.p2.x = players[1]->transform.position()[1];
+			sim.p2.y = players[1]->transform.position()[2];
+			sim.ball_x = ball->transform.position()[1];
+			sim.ball_y = ball->transform.position()[2];
+
+			//a replay brings its own starting state and step size:
+			if (config.replay != "") {
+				sim = replay.initial;
+			}
+			previous_sim = sim;
+			recording.initial = sim;
 
-	float ball_vel_x = 0.0f;
-	float ball_vel_y = 0.0f;
+			if (config.net) {
+				session.reset(new NetSession(config.net_config, sim, sim_dt, &world));
+				if (session->is_host()) {
+					std::cout << "Waiting for player 2 on port " << session->socket.local_port() << "..." << std::endl;
+				} else {
+					std::cout << "Connecting to " << session->peer.to_string() << " as player 2..." << std::endl;
+				}
+			}
 
-	float gravity = -10.0f;
+			//(the match starts now, not when the window opened)
+			accumulator = 0.0f;
+			previous_time = std::chrono::steady_clock::now();
+			scene_loaded = true;
+		};
+	});
+
+	//when a blob is re-exported, load it again:
+	// (reads can fail if a file is caught part-way through being written; that's reported, not fatal)
+	// (reloads read files into memory instead of mapping them, since the exporter may rewrite a file
+	//  again while its parsed data waits to be uploaded)
+	// (not during networked play, where a changed court would make the two sides disagree,
+	//  nor while recording or replaying, since replays don't know the court changed part-way through)
+	// (rewinding can't go back past a reload: the saved states were made with the old court)
+	FileWatcher watcher;
+	if (!config.net && config.record == "" && config.replay == "") {
+		watcher.watch("meshes.blob");
+		watcher.watch("scene.blob");
+	}
 
-	int p1_score = 0;
-	int p2_score = 0;
+	auto reload = [&](std::string const &filename) {
+		if (filename == "meshes.blob") {
+			loader.load([&, filename]() -> AssetLoader::Finish {
+				std::shared_ptr< Meshes::Parsed > parsed;
+				try {
+					parsed = std::make_shared< Meshes::Parsed >(Meshes::parse(filename, MappedFile::Read));
+				} catch (std::exception &e) {
+					std::string what = e.what();
+					return [filename, what]() {
+						std::cerr << "WARNING: not reloading '" << filename << "': " << what << std::endl;
+					};
+				}
+				return [&, filename, parsed]() {
+					uint32_t revision = meshes.revision;
+					size_t changed = meshes.reload(*parsed, attributes);
+					if (meshes.revision != revision) {
+						refresh_meshes();
+						try {
+							build_world(placed, [&meshes](NameID name) -> Mesh const & { return meshes.get(name); });
+						} catch (std::exception &e) {
+							std::cerr << "WARNING: obstacles not updated: " << e.what() << std::endl;
+						}
+						history.clear();
+					}
+					std::cout << "Reloaded '" << filename << "' (" << changed << " meshes uploaded)." << std::endl;
+				};
+			});
+		} else if (filename == "scene.blob") {
+			loader.load([&, filename]() -> AssetLoader::Finish {
+				Placements placements;
+				try {
+					placements = read_scene(filename, MappedFile::Read);
+				} catch (std::exception &e) {
+					std::string what = e.what();
+					return [filename, what]() {
+						std::cerr << "WARNING: not reloading '" << filename << "': " << what << std::endl;
+					};
+				}
+				return [&, filename, placements]() {
+					try {
+						apply_scene(*placements);
+					} catch (std::exception &e) {
+						std::cerr << "WARNING: '" << filename << "' only partly reloaded: " << e.what() << std::endl;
+						return;
+					}
+					history.clear();
+					std::cout << "Reloaded '" << filename << "'." << std::endl;
+				};
+			});
+		}
+	};
 
-	bool game_over = false;
+	glm::vec2 mouse = glm::vec2(0.0f, 0.0f); //mouse position in [-1,1]x[-1,1] coordinates
 
-	bool p1_touch_last = false;
+	struct {
+		float radius = 15.0f;
+		float elevation = 0.3f;
+		float azimuth = 0.0f;
+		glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
+	} camera;
 
 	//------------ game loop ------------
 
@@ -307,435 +729,153 @@ int main(int argc, char **argv) {
 		}
 		if (should_quit) break;
 
-		// record a snapshot of the keyboard state
-		const Uint8 *state = SDL_GetKeyboardState(NULL);
-		if (state[SDL_SCANCODE_A]) {
-			if (players[0]->transform.position[1] > -9.5f){
-		    	players[0]->transform.position[1] -= 0.1f;
-		    	p1_left = true;
-		    }
-		    p1_left = false;
-		} else {
-			p1_left = false;
-		}
-		if (state[SDL_SCANCODE_D]) {
-			if (players[0]->transform.position[1] < -0.55f){
-		    	players[0]->transform.position[1] += 0.1f; 
-		    	p1_right = true;
-		    }
-		    p1_right = false;
-		} else {
-			p1_right = false;
-		}
-		if (state[SDL_SCANCODE_W]) {
-			if (p1_can_jump){
-		    	p1_vel_y = 6.0f;
-		    	p1_can_jump = false;
-		    	p1_jumped = true;
-		    }
+		//pick up re-exported assets, and finish some background loads:
+		for (auto const &filename : watcher.poll()) {
+			reload(filename);
 		}
-		if (state[SDL_SCANCODE_LEFT]) {
-			if (players[1]->transform.position[1] > 0.55f){
-		    	players[1]->transform.position[1] -= 0.1f; 
-		    	p2_left = true;
-		    }
-		    p2_left = false;
-		} else {
-			p2_left = false;
-		}
-		if (state[SDL_SCANCODE_RIGHT]) {
-			if (players[1]->transform.position[1] < 9.5f){
-		    	players[1]->transform.position[1] += 0.1f; 
-		    	p2_right = true;
-			}
-			p2_right = false;
-		} else {
-			p2_right = false;
-		}
-		if (state[SDL_SCANCODE_UP]) {
-			if (p2_can_jump){
-		    	p2_vel_y = 6.0f;
-		    	p2_can_jump = false;
-		    	p2_jumped = true;
-		    }
-		}
-
-		//collision detection calculations
-
-		{ //update game state:
-			//update player 1 (divide calculations by framerate, i.e. 60fps)
-			//don't let the player fall through the floor
-			if ((players[0]->transform.position[2] != 0.5f) || p1_jumped){
-				players[0]->transform.position[2] += (p1_vel_y / 60.0f);
-
-				//if the player reached the floor, reset velocity and z position
-				if (players[0]->transform.position[2] <= 0.5f){
-					players[0]->transform.position[2] = 0.5f;
-					p1_vel_y = 0.0f;
-					p1_can_jump = true;
-				}
-
-				p1_jumped = false;
-			}
-
-			//update player 2 (divide calculations by framerate, i.e. 60fps)
-			//don't let the player fall through the floor
-			if ((players[1]->transform.position[2] != 0.5f) || p2_jumped){
-				players[1]->transform.position[2] += (p2_vel_y / 60.0f);
-
-				//if the player reached the floor, reset velocity and z position
-				if (players[1]->transform.position[2] <= 0.5f){
-					players[1]->transform.position[2] = 0.5f;
-					p2_vel_y = 0.0f;
-					p2_can_jump = true;
-				}
-
-				p2_jumped = false;
-			}
-
-			//update ball's velocity
-			ball->transform.position[2] += (ball_vel_y / 60.0f);
-			ball->transform.position[1] += (ball_vel_x / 60.0f);
-
-			//if the ball reached the left wall, reverse the x direction
-			if (ball->transform.position[1] <= -9.15f){
-				ball->transform.position[1] = -9.15f;
-				ball_vel_x *= -1.0f;
-			}
-
-			//if the ball reached the right wall, reverse the x direction
-			if (ball->transform.position[1] >= 9.15f){
-				ball->transform.position[1] = 9.15f;
-				ball_vel_x *= -1.0f;
-			}
-
-
-			//grab ball position
-			ball_pos_x = ball->transform.position[1];
-			ball_pos_y = ball->transform.position[2];
-
-			hit_corner = false;
-
-			/*check if the ball hits one of the corners of a player first*/
-			//player 1 corners
-			p1_c1_x = players[0]->transform.position[1] - 0.5f;
-			p1_c1_y = players[0]->transform.position[2] + 0.5f;
-
-			distance = sqrt(pow((ball_pos_x - p1_c1_x),2) + pow((ball_pos_y - p1_c1_y),2));
-
-			if ((distance <= 0.35f) && !hit_corner){
-				hit_corner = true;
-				ball_vel_y = 8.0f;
-				ball_vel_x -= 1.5f;
-				ball_vel_x += -1.0f * p1_left;
-				ball_vel_x += 1.0f * p1_right;
-
-				p1_touch_last = true;
-			}
-
-			p1_c2_x = players[0]->transform.position[1] + 0.5f;
-			p1_c2_y = players[0]->transform.position[2] + 0.5f;
+		loader.update(config.load_budget);
 
-			distance = sqrt(pow((ball_pos_x - p1_c2_x),2) + pow((ball_pos_y - p1_c2_y),2));
-
-			if ((distance <= 0.35f) && !hit_corner){
-				hit_corner = true;
-				ball_vel_y = 8.0f;
-				ball_vel_x += 1.5f;
-				ball_vel_x += -1.0f * p1_left;
-				ball_vel_x += 1.0f * p1_right;
-
-				p1_touch_last = true;
-			}
-
-			//player 2 corners
-			p2_c1_x = players[1]->transform.position[1] - 0.5f;
-			p2_c1_y = players[1]->transform.position[2] + 0.5f;
-
-			distance = sqrt(pow((ball_pos_x - p2_c1_x),2) + pow((ball_pos_y - p2_c1_y),2));
-
-			if ((distance <= 0.35f) && !hit_corner){
-				hit_corner = true;
-				ball_vel_y = 8.0f;
-				ball_vel_x -= 1.5f;
-				ball_vel_x += -1.0f * p2_left;
-				ball_vel_x += 1.0f * p2_right;
-
-				p1_touch_last = false;
+		// record a snapshot of the keyboard state
+		const Uint8 *state = SDL_GetKeyboardState(NULL);
+		VolleyballSim::Inputs inputs;
+		inputs.p1_left = state[SDL_SCANCODE_A];
+		inputs.p1_right = state[SDL_SCANCODE_D];
+		inputs.p1_jump = state[SDL_SCANCODE_W];
+		inputs.p2_left = state[SDL_SCANCODE_LEFT];
+		inputs.p2_right = state[SDL_SCANCODE_RIGHT];
+		inputs.p2_jump = state[SDL_SCANCODE_UP];
+		bool rewind = (state[SDL_SCANCODE_BACKSPACE] != 0) && !session;
+		if (session) {
+			//a networked player can use either set of keys (the session only takes this side's player's controls):
+			inputs.p1_left = inputs.p2_left = (inputs.p1_left || inputs.p2_left);
+			inputs.p1_right = inputs.p2_right = (inputs.p1_right || inputs.p2_right);
+			inputs.p1_jump = inputs.p2_jump = (inputs.p1_jump || inputs.p2_jump);
+
+			//hear from the peer (which may rewrite recent frames):
+			try {
+				session->poll();
+			} catch (std::exception &e) {
+				std::cerr << "ERROR: networked match stopped: " << e.what() << std::endl;
+				break;
 			}
-
-			p2_c2_x = players[1]->transform.position[1] + 0.5f;
-			p2_c2_y = players[1]->transform.position[2] + 0.5f;
-
-			distance = sqrt(pow((ball_pos_x - p2_c2_x),2) + pow((ball_pos_y - p2_c2_y),2));
-
-			if ((distance <= 0.35f) && !hit_corner){
-				hit_corner = true;
-				ball_vel_y = 8.0f;
-				ball_vel_x += 1.5f;
-				ball_vel_x += -1.0f * p2_left;
-				ball_vel_x += 1.0f * p2_right;
-
-				p1_touch_last = false;
+			sim = session->rollback.state();
+			if (session->rollback.rollbacks != rollbacks_seen) {
+				//(so the display doesn't blend a state from before the correction with one from after it)
+				rollbacks_seen = session->rollback.rollbacks;
+				if (!session->rollback.previous_state(&previous_sim)) previous_sim = sim;
 			}
-
-			hit_top = false;
-
-			//if the ball has hit player 1's head, bounce the ball upward
-			if ((ball->transform.position[2] <= (players[0]->transform.position[2] + 0.5f)) &&
-				(ball->transform.position[2] >= (players[0]->transform.position[2] + 0.25f)) &&
-				(ball->transform.position[1] <= (players[0]->transform.position[1] + 0.5f)) &&
-				(ball->transform.position[1] >= (players[0]->transform.position[1] - 0.5f)) &&
-				!hit_corner && !hit_top){
-
-				ball->transform.position[2] = players[0]->transform.position[2] + 0.85f;
-				ball_vel_y = 8.0f;
-				ball_vel_x += -1.0f * p1_left;
-				ball_vel_x += 1.0f * p1_right;
-
-				p1_touch_last = true;
-
-				hit_top = true;
-			}	
-
-
-			//if the ball has hit player 2's head, bounce the ball upward
-			if ((ball->transform.position[2] <= (players[1]->transform.position[2] + 0.5f)) &&
-				(ball->transform.position[2] >= (players[1]->transform.position[2] + 0.25f)) &&
-				(ball->transform.position[1] <= (players[1]->transform.position[1] + 0.5f)) &&
-				(ball->transform.position[1] >= (players[1]->transform.position[1] - 0.5f)) &&
-				!hit_corner && !hit_top){
-
-				ball->transform.position[2] = players[1]->transform.position[2] + 0.85f;
-				ball_vel_y = 8.0f;
-				ball_vel_x += -1.0f * p2_left;
-				ball_vel_x += 1.0f * p2_right;
-
-				p1_touch_last = false;
-
-				hit_top = true;
-			}
-
-			hit_side = false;
-
-			//if the ball has hit player 1's left wall, bounce the ball to the left
-			if ((ball->transform.position[2] <= (players[0]->transform.position[2] + 0.5f)) &&
-				(ball->transform.position[2] >= (players[0]->transform.position[2] - 0.5f)) &&
-				(ball->transform.position[1] <= (players[0]->transform.position[1] - 0.4f)) &&
-				(ball->transform.position[1] >= (players[0]->transform.position[1] - 0.85f)) &&
-				!hit_corner && !hit_top && !hit_side){
-
-				ball->transform.position[1] = players[0]->transform.position[1] - 0.85f;
-
-				if (ball_vel_x >= 0.0){
-					ball_vel_x *= -1.0f;
-				}
-
-				p1_touch_last = true;
-
-				hit_side = true;
-			}	
-
-			//if the ball has hit player 1's right wall, bounce the ball to the right
-			if ((ball->transform.position[2] <= (players[0]->transform.position[2] + 0.5f)) &&
-				(ball->transform.position[2] >= (players[0]->transform.position[2] - 0.5f)) &&
-				(ball->transform.position[1] >= (players[0]->transform.position[1] + 0.4f)) &&
-				(ball->transform.position[1] <= (players[0]->transform.position[1] + 0.85f)) &&
-				!hit_corner && !hit_top && !hit_side){
-
-				ball->transform.position[1] = players[0]->transform.position[1] + 0.85f;
-				
-				if (ball_vel_x <= 0.0){
-					ball_vel_x *= -1.0f;
-				}
-
-				p1_touch_last = true;
-
-				hit_side = true;
-			}	
-
-			//if the ball has hit player 2's left wall, bounce the ball to the left
-			if ((ball->transform.position[2] <= (players[1]->transform.position[2] + 0.5f)) &&
-				(ball->transform.position[2] >= (players[1]->transform.position[2] - 0.5f)) &&
-				(ball->transform.position[1] <= (players[1]->transform.position[1] - 0.4f)) &&
-				(ball->transform.position[1] >= (players[1]->transform.position[1] - 0.85f)) &&
-				!hit_corner && !hit_top && !hit_side){
-
-				ball->transform.position[1] = players[1]->transform.position[1] - 0.85f;
-				
-				if (ball_vel_x >= 0.0){
-					ball_vel_x *= -1.0f;
-				}
-
-				p1_touch_last = false;
-
-				hit_side = true;
+			if (session->connected() && !net_connected) {
+				std::cout << "Connected." << std::endl;
+				net_connected = true;
 			}
+		}
 
-			//if the ball has hit player 2's left wall, bounce the ball to the left
-			if ((ball->transform.position[2] <= (players[1]->transform.position[2] + 0.5f)) &&
-				(ball->transform.position[2] >= (players[1]->transform.position[2] - 0.5f)) &&
-				(ball->transform.position[1] >= (players[1]->transform.position[1] + 0.4f)) &&
-				(ball->transform.position[1] <= (players[1]->transform.position[1] + 0.85f)) &&
-				!hit_corner && !hit_top && !hit_side){
-
-				ball->transform.position[1] = players[1]->transform.position[1] + 0.85f;
-				
-				if (ball_vel_x <= 0.0){
-					ball_vel_x *= -1.0f;
-				}
-
-				p1_touch_last = false;
-
-				hit_side = true;
-			}		
-
-			//check if the ball has hit the net
-
-			/*check if the ball hits the top of the net first*/
-			//player 1 corners
-			net_c_x = net->transform.position[1] - 0.5f;
-			net_c_y = net->transform.position[2] + 0.5f;
-
-			distance = sqrt(pow((ball_pos_x - net_c_x),2) + pow((ball_pos_y - net_c_y),2));
-
-			if (distance <= 0.35f){
-				ball->transform.position[1] = players[0]->transform.position[1];
-				ball->transform.position[2] = 4.0f;
-				ball_vel_y = 0.0f;
-				ball_vel_x = 0.0f;
-
-				if (p1_touch_last){
-					p2_score += 1;
-				} else {
-					p1_score += 1;
-				}
-
-				printf("Current Score: p1 %i | p2 %i\n", p1_score, p2_score);
-
-				if ((p1_score == 10) || (p2_score == 10)){
-					printf("GAME OVER: ");
-					if (p1_score == 10){
-						printf("Player1 wins!\n");
-					} else {
-						printf("Player2 wins!\n");
+		if (scene_loaded) { //update game state:
+			//run as many fixed-size simulation steps as real time has elapsed:
+			auto now = std::chrono::steady_clock::now();
+			float elapsed = std::chrono::duration< float >(now - previous_time).count();
+			previous_time = now;
+			accumulator += std::min(elapsed, config.max_catch_up) * config.speed;
+
+			while (accumulator >= sim_dt) {
+				if (rewind) {
+					//step back instead of forward (as far as the history goes):
+					if (sim_frame > 0 && history.has(sim_frame - 1)) {
+						previous_sim = sim;
+						sim_frame -= 1;
+						history.restore(sim_frame, &sim);
+						//(the undone steps are undone in the recording too, and replays resume from here)
+						if (config.record != "") recording.inputs.resize(sim_frame);
+						replay_step = std::min(replay_step, size_t(sim_frame));
 					}
-					game_over = true;
-				}
-			}
-
-
-			//if the ball has hit the net's left wall, reset the ball
-			if ((ball->transform.position[2] <= (net->transform.position[2] + 1.0f)) &&
-				(ball->transform.position[1] <= (net->transform.position[1] - 0.0f)) &&
-				(ball->transform.position[1] >= (net->transform.position[1] - 0.40f))){
-
-				ball->transform.position[1] = players[0]->transform.position[1];
-				ball->transform.position[2] = 4.0f;
-				ball_vel_y = 0.0f;
-				ball_vel_x = 0.0f;
-
-				if (p1_touch_last){
-					p2_score += 1;
-				} else {
-					p1_score += 1;
+					accumulator -= sim_dt;
+					continue;
 				}
 
-				printf("Current Score: p1 %i | p2 %i\n", p1_score, p2_score);
-
-				if ((p1_score == 10) || (p2_score == 10)){
-					printf("GAME OVER: ");
-					if (p1_score == 10){
-						printf("Player1 wins!\n");
-					} else {
-						printf("Player2 wins!\n");
+				//during playback, recorded controls replace the keyboard (until the replay runs out):
+				VolleyballSim::Inputs step_inputs = inputs;
+				if (replay_step < replay.inputs.size()) {
+					step_inputs = VolleyballSim::Inputs::from_bits(replay.inputs[replay_step]);
+					replay_step += 1;
+					if (replay_step == replay.inputs.size()) {
+						std::cout << "Replay finished; keyboard has control." << std::endl;
 					}
-					game_over = true;
 				}
-			}
-
-			//if the ball has hit the net's left wall, bounce the ball to the left
-			if ((ball->transform.position[2] <= (net->transform.position[2] + 1.0f)) &&
-				(ball->transform.position[1] >= (net->transform.position[1] + 0.0f)) &&
-				(ball->transform.position[1] <= (net->transform.position[1] + 0.40f))){
-
-				ball->transform.position[1] = players[0]->transform.position[1];
-				ball->transform.position[2] = 4.0f;
-				ball_vel_y = 0.0f;
-				ball_vel_x = 0.0f;
-
-				if (p1_touch_last){
-					p2_score += 1;
-				} else {
-					p1_score += 1;
+				if (config.record != "") {
+					recording.inputs.emplace_back(step_inputs.to_bits());
 				}
 
-				printf("Current Score: p1 %i | p2 %i\n", p1_score, p2_score);
-
-				if ((p1_score == 10) || (p2_score == 10)){
-					printf("GAME OVER: ");
-					if (p1_score == 10){
-						printf("Player1 wins!\n");
-					} else {
-						printf("Player2 wins!\n");
+				if (session) {
+					bool advanced = false;
+					try {
+						advanced = session->advance(step_inputs);
+					} catch (std::exception &e) {
+						std::cerr << "ERROR: networked match stopped: " << e.what() << std::endl;
+						should_quit = true;
+						break;
 					}
-					game_over = true;
-				}
-			}	
-
-			//if the ball reached the floor, reset velocity and z position
-			if (ball->transform.position[2] <= 0.35f){
-				if (ball->transform.position[1] >= 0){
-					p1_score += 1;
+					if (!advanced) {
+						//too far ahead of the peer; wait for it rather than rushing to catch up later:
+						accumulator = 0.0f;
+						break;
+					}
+					previous_sim = sim;
+					sim = session->rollback.state();
 				} else {
-					p2_score += 1;
+					history.save(sim_frame, sim);
+					previous_sim = sim;
+					sim.step(sim_dt, step_inputs, &world);
+					sim_frame += 1;
 				}
+				accumulator -= sim_dt;
 
-				printf("Current Score: p1 %i | p2 %i\n", p1_score, p2_score);
-
-				if ((p1_score == 10) || (p2_score == 10)){
+				if (sim.p1_score != previous_sim.p1_score || sim.p2_score != previous_sim.p2_score) {
+					printf("Current Score: p1 %i | p2 %i\n", sim.p1_score, sim.p2_score);
+				}
+				if (sim.game_over && !previous_sim.game_over) {
 					printf("GAME OVER: ");
-					if (p1_score == 10){
+					if (sim.p1_score == VolleyballSim::WinningScore) {
 						printf("Player1 wins!\n");
 					} else {
 						printf("Player2 wins!\n");
 					}
-					game_over = true;
 				}
-
-				ball->transform.position[1] = players[0]->transform.position[1];
-				ball->transform.position[2] = 4.0f;
-				ball_vel_y = 0.0f;
-				ball_vel_x = 0.0f;
 			}
 
-			//apply gravity to velocities
-			//don't apply gravity when the players are on the floor
-			if (players[0]->transform.position[2] != 0.5f){
-				p1_vel_y += (gravity / 60.0f);
-			}
-			if (players[1]->transform.position[2] != 0.5f){
-				p2_vel_y += (gravity / 60.0f);
-			}
-			if (!game_over){
-				ball_vel_y += (gravity / 60.0f);
-			}
+			//show the state part way between the last two simulation steps:
+			float alpha = accumulator / sim_dt;
+			auto lerp = [alpha](float a, float b) {
+				return a + (b - a) * alpha;
+			};
+			//(sim x, y are world y, z)
+			auto place = [](Scene::Transform &transform, float x, float y) {
+				transform.set_position(glm::vec3(transform.position().x, x, y));
+			};
+			place(players[0]->transform, lerp(previous_sim.p1.x, sim.p1.x), lerp(previous_sim.p1.y, sim.p1.y));
+			place(players[1]->transform, lerp(previous_sim.p2.x, sim.p2.x), lerp(previous_sim.p2.y, sim.p2.y));
+			//(a scored point teleports the ball back to the serve, so don't slide it there)
+			bool served = (sim.p1_score != previous_sim.p1_score || sim.p2_score != previous_sim.p2_score);
+			place(ball->transform,
+				served ? sim.ball_x : lerp(previous_sim.ball_x, sim.ball_x),
+				served ? sim.ball_y : lerp(previous_sim.ball_y, sim.ball_y));
 
 			//camera:
-			scene.camera.transform.position = camera.radius * glm::vec3(
+			scene.camera.transform.set_position(camera.radius * glm::vec3(
 				std::cos(camera.elevation) * std::cos(camera.azimuth),
 				std::cos(camera.elevation) * std::sin(camera.azimuth),
-				std::sin(camera.elevation)) + camera.target;
+				std::sin(camera.elevation)) + camera.target);
 
-			glm::vec3 out = -glm::normalize(camera.target - scene.camera.transform.position);
+			glm::vec3 out = -glm::normalize(camera.target - scene.camera.transform.position());
 			glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
 			up = glm::normalize(up - glm::dot(up, out) * out);
 			glm::vec3 right = glm::cross(up, out);
 			
-			scene.camera.transform.rotation = glm::quat_cast(
+			scene.camera.transform.set_rotation(glm::quat_cast(
 				glm::mat3(right, up, out)
-			);
-			scene.camera.transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
+			));
+			scene.camera.transform.set_scale(glm::vec3(1.0f, 1.0f, 1.0f));
+		} else {
+			previous_time = std::chrono::steady_clock::now(); //(keeps the frame rate cap working while loading)
 		}
 
 		//draw output:
@@ -747,18 +887,33 @@ int main(int argc, char **argv) {
 
 
 		{ //draw game state:
-			glUseProgram(program);
-			glUniform3fv(program_to_light, 1, glm::value_ptr(glm::normalize(glm::vec3(0.0f, 1.0f, 10.0f))));
 			scene.render();
 		}
 
 
 		SDL_GL_SwapWindow(window);
+
+		if (!vsync) { //without vsync, don't spin the GPU drawing frames nobody will see:
+			auto frame_end = previous_time + std::chrono::duration< float >(1.0f / config.max_fps);
+			std::this_thread::sleep_until(frame_end);
+		}
 	}
 
 
 	//------------  teardown ------------
 
+	if (config.record != "") {
+		recording.save(config.record);
+		std::cout << "Wrote " << recording.inputs.size() << " steps to '" << config.record << "'." << std::endl;
+	}
+
+	if (session) {
+		Rollback const &rollback = session->rollback;
+		std::cout << "Played " << rollback.frame() << " frames; " << rollback.rollbacks << " rollbacks re-simulated " << rollback.resimulated
+			<< " frames (slowest took " << rollback.slowest_rollback * 1000.0f << " ms); packets: " << session->packets_sent << " sent, "
+			<< session->packets_dropped << " dropped on purpose, " << session->packets_received << " received." << std::endl;
+	}
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
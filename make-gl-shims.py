@@ -35,7 +35,7 @@ with open('glcorearb.h', 'r') as f:
 				pass
 			if do_extension:
 			#	m = re.match(r".* PFNGL([^)]+)PROC\)", line)
-				m = re.match(r"GLAPI .* APIENTRY gl([^ ]+) \(", line)
+				m = re.match(r"GLAPI .*APIENTRY gl([^ ]+) \(", line)
 				if m != None:
 					lc = m.group(1)
 					uc = lc.upper()
@@ -8,10 +8,19 @@
 #reads 'island.blend' and writes '../dist/meshes.blob' (meshes) and '../dist/scene.blob' (scene in layer 1)
 
 import sys
+import os
 
 import bpy
 import struct
 
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+from write_blob import write_blob, name_hash
+from index_mesh import index_mesh
+from pack_vertices import vertex_bounds, quantize_vertices
+
+#write 12-byte quantized vertices ('q3n1') instead of 24-byte float ones ('v3n3'):
+QUANTIZE = True
+
 bpy.ops.wm.open_mainfile(filepath='robot.blend')
 
 #names of objects whose meshes to write (not actually the names of the meshes):
@@ -36,14 +45,25 @@ to_write = [
 	'Link3',
 ]
 
-#data contains vertex and normal data from the meshes:
+#data contains (deduplicated) vertex and normal data from the meshes:
 data = b''
 
+#elements16 / elements32 contain triangle lists indexing into each mesh's vertices
+# (meshes with few enough vertices get 16-bit indices):
+elements16 = b''
+elements32 = b''
+
 #strings contains the mesh names:
 strings = b''
 
-#index gives offsets into the data (and names) for each mesh:
+#index gives offsets into the data, elements, and names for each mesh:
 index = b''
+name_hashes = {} #hash -> name, to catch collisions
+
+#bounds gives each mesh's bounding box (in index order):
+bounds = b''
+#(vertices of every mesh, kept around for quantization)
+mesh_vertices = []
 
 vertex_count = 0
 for name in to_write:
@@ -71,7 +91,17 @@ for name in to_write:
 	mesh = obj.data
 	mesh.calc_normals_split()
 
-	#record mesh name, start position and vertex count in the index:
+	#gather triangle corners, then share identical ones:
+	corners = []
+	for poly in mesh.polygons:
+		assert(len(poly.loop_indices) == 3)
+		for i in range(0,3):
+			assert(mesh.loops[poly.loop_indices[i]].vertex_index == poly.vertices[i])
+			loop = mesh.loops[poly.loop_indices[i]]
+			corners.append(struct.pack('3f', *mesh.vertices[loop.vertex_index].co) + struct.pack('3f', *loop.normal))
+	(vertices, indices) = index_mesh(corners)
+
+	#record mesh name, vertex range, and index range in the index:
 	name_begin = len(strings)
 	strings += bytes(name, "utf8")
 	name_end = len(strings)
@@ -79,40 +109,53 @@ for name in to_write:
 	index += struct.pack('I', name_end)
 
 	index += struct.pack('I', vertex_count)
-	index += struct.pack('I', len(mesh.polygons) * 3)
+	index += struct.pack('I', len(vertices))
+
+	if len(vertices) <= 0x10000:
+		index += struct.pack('I', len(elements16) // 2)
+		index += struct.pack('I', len(indices))
+		index += struct.pack('I', 16)
+		elements16 += struct.pack(str(len(indices)) + 'H', *indices)
+	else:
+		index += struct.pack('I', len(elements32) // 4)
+		index += struct.pack('I', len(indices))
+		index += struct.pack('I', 32)
+		elements32 += struct.pack(str(len(indices)) + 'I', *indices)
+	index += struct.pack('I', name_hash(name, name_hashes)) #name hash (matches NameID in NameID.hpp)
+
+	(lo, hi) = vertex_bounds(vertices)
+	bounds += struct.pack('3f', *lo) + struct.pack('3f', *hi)
 
 	#write the mesh:
-	for poly in mesh.polygons:
-		assert(len(poly.loop_indices) == 3)
-		for i in range(0,3):
-			assert(mesh.loops[poly.loop_indices[i]].vertex_index == poly.vertices[i])
-			loop = mesh.loops[poly.loop_indices[i]]
-			vertex = mesh.vertices[loop.vertex_index]
-			for x in mesh.vertices[loop.vertex_index].co:
-				data += struct.pack('f', x)
-			for x in loop.normal:
-				data += struct.pack('f', x)
-	vertex_count += len(mesh.polygons) * 3
+	for v in vertices:
+		data += v
+	mesh_vertices.append(vertices)
+	print("  " + str(len(corners)) + " corners -> " + str(len(vertices)) + " vertices")
+	vertex_count += len(vertices)
 
 #check that we wrote as much data as anticipated:
 assert(vertex_count * (3 * 4 + 3 * 4) == len(data))
 
-#write the data chunk and index chunk to an output blob:
-blob = open('../dist/meshes.blob', 'wb')
-#first chunk: the data
-blob.write(struct.pack('4s',b'v3n3')) #type
-blob.write(struct.pack('I', len(data))) #length
-blob.write(data)
-#second chunk: the strings
-blob.write(struct.pack('4s',b'str0')) #type
-blob.write(struct.pack('I', len(strings))) #length
-blob.write(strings)
-#third chunk: the index
-blob.write(struct.pack('4s',b'idx0')) #type
-blob.write(struct.pack('I', len(index))) #length
-blob.write(index)
-
-print("Wrote " + str(blob.tell()) + " bytes to meshes.blob")
+if QUANTIZE:
+	packed = b''
+	for vertices in mesh_vertices:
+		(lo, hi) = vertex_bounds(vertices)
+		packed += quantize_vertices(vertices, lo, hi)
+	vertex_chunk = (b'q3n1', packed)
+else:
+	vertex_chunk = (b'v3n3', data)
+
+#write the data, strings, elements, bounds, and index chunks to an output blob:
+size = write_blob('../dist/meshes.blob', [
+	vertex_chunk,
+	(b'str0', strings),
+	(b'ix16', elements16),
+	(b'ix32', elements32),
+	(b'bnd0', bounds),
+	(b'idx1', index),
+])
+
+print("Wrote " + str(size) + " bytes to meshes.blob")
 
 #---------------------------------------------------------------------
 #Export scene (object positions for every object on layer one)
@@ -146,15 +189,10 @@ for obj in bpy.data.objects:
 	scene += struct.pack('3f', transform[2].x, transform[2].y, transform[2].z)
 
 #write the strings chunk and scene chunk to an output blob:
-blob = open('../dist/scene.blob', 'wb')
-#first chunk: the strings
-blob.write(struct.pack('4s',b'str0')) #type
-blob.write(struct.pack('I', len(strings))) #length
-blob.write(strings)
-#second chunk: the scene
-blob.write(struct.pack('4s',b'scn0')) #type
-blob.write(struct.pack('I', len(scene))) #length
-blob.write(scene)
-
-print("Wrote " + str(blob.tell()) + " bytes to scene.blob")
+size = write_blob('../dist/scene.blob', [
+	(b'str0', strings),
+	(b'scn0', scene),
+])
+
+print("Wrote " + str(size) + " bytes to scene.blob")
 
@@ -0,0 +1,97 @@
+#helpers shared by the export scripts for building indexed meshes.
+
+#index_mesh(corners) takes a triangle list (one packed vertex -- a bytes object -- per corner) and returns
+# (vertices, indices): the distinct vertices and a triangle index list that refers to them.
+#Triangles are reordered for post-transform vertex cache hits with 'Tipsify'
+# (Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007),
+# and vertices are then renumbered in order of first use, so vertex fetch walks memory mostly forward.
+
+CACHE_SIZE = 16
+
+def tipsify(indices, vertex_count, cache_size=CACHE_SIZE):
+	tri_count = len(indices) // 3
+
+	#triangles using each vertex:
+	adjacency = [[] for v in range(vertex_count)]
+	for t in range(tri_count):
+		for k in range(3):
+			adjacency[indices[3*t+k]].append(t)
+
+	live = [len(a) for a in adjacency] #un-emitted triangles using each vertex
+	cache_time = [0] * vertex_count #when each vertex last entered the (simulated) cache
+	emitted = [False] * tri_count
+	dead_end = [] #recently used vertices, to restart fanning from
+	out = []
+
+	time = cache_size + 1
+	cursor = 0 #for scanning for any vertex with live triangles
+	fan = 0 if vertex_count > 0 else -1
+	while fan >= 0:
+		candidates = []
+		#emit every remaining triangle around the fanning vertex:
+		for t in adjacency[fan]:
+			if emitted[t]: continue
+			for k in range(3):
+				v = indices[3*t+k]
+				out.append(v)
+				dead_end.append(v)
+				candidates.append(v)
+				live[v] -= 1
+				if time - cache_time[v] > cache_size:
+					cache_time[v] = time
+					time += 1
+			emitted[t] = True
+
+		#next fanning vertex: the oldest candidate still in the cache after its remaining triangles are emitted:
+		fan = -1
+		best = -1
+		for v in candidates:
+			if live[v] == 0: continue
+			priority = 0
+			if time - cache_time[v] + 2 * live[v] <= cache_size:
+				priority = time - cache_time[v]
+			if priority > best:
+				best = priority
+				fan = v
+
+		if fan == -1:
+			while len(dead_end) > 0:
+				v = dead_end.pop()
+				if live[v] > 0:
+					fan = v
+					break
+		if fan == -1:
+			while cursor < vertex_count:
+				if live[cursor] > 0:
+					fan = cursor
+					break
+				cursor += 1
+
+	assert(len(out) == len(indices))
+	return out
+
+def index_mesh(corners):
+	assert(len(corners) % 3 == 0)
+
+	#deduplicate identical vertices:
+	vertices = []
+	lookup = dict()
+	indices = []
+	for c in corners:
+		if c not in lookup:
+			lookup[c] = len(vertices)
+			vertices.append(c)
+		indices.append(lookup[c])
+
+	indices = tipsify(indices, len(vertices))
+
+	#renumber vertices in order of first use:
+	remap = dict()
+	ordered = []
+	for i in indices:
+		if i not in remap:
+			remap[i] = len(ordered)
+			ordered.append(vertices[i])
+	indices = [remap[i] for i in indices]
+
+	return (ordered, indices)
@@ -0,0 +1,40 @@
+#helpers shared by the export scripts for bounding and packing v3n3 vertices
+# (each vertex is a 24-byte bytes object: float position x,y,z then float normal x,y,z).
+
+import struct
+
+#axis-aligned bounding box of a list of vertices, as (min, max) tuples:
+def vertex_bounds(vertices):
+	lo = [float('inf')] * 3
+	hi = [float('-inf')] * 3
+	for v in vertices:
+		p = struct.unpack('3f', v[0:12])
+		for i in range(3):
+			lo[i] = min(lo[i], p[i])
+			hi[i] = max(hi[i], p[i])
+	if len(vertices) == 0:
+		lo = [0.0] * 3
+		hi = [0.0] * 3
+	return (tuple(lo), tuple(hi))
+
+#pack vertices as 'q3n1' (12 bytes each):
+# position as three int16 normalized so [-32767,32767] spans [lo,hi] (plus one int16 of padding),
+# normal as GL_INT_2_10_10_10_REV (x in the low ten bits, then y, then z).
+def quantize_vertices(vertices, lo, hi):
+	center = [0.5 * (hi[i] + lo[i]) for i in range(3)]
+	radius = [0.5 * (hi[i] - lo[i]) for i in range(3)]
+	def snorm(x, bits):
+		scale = (1 << (bits - 1)) - 1
+		return max(-scale, min(scale, int(round(x * scale))))
+
+	out = b''
+	for v in vertices:
+		p = struct.unpack('3f', v[0:12])
+		n = struct.unpack('3f', v[12:24])
+		q = [snorm((p[i] - center[i]) / radius[i], 16) if radius[i] > 0.0 else 0 for i in range(3)]
+		out += struct.pack('4h', q[0], q[1], q[2], 0)
+		packed = 0
+		for i in range(3):
+			packed |= (snorm(n[i], 10) & 0x3ff) << (10 * i)
+		out += struct.pack('I', packed)
+	return out
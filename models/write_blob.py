@@ -0,0 +1,53 @@
+#helpers shared by the export scripts for writing '.blob' files.
+
+#Blob layout (all integers little-endian uint32):
+#  header: 'blob' magic, version (1), chunk count, reserved (0)
+#  chunk table, one entry per chunk: 4-byte magic, offset (from start of file), size (bytes), FNV-1a checksum of payload
+#  chunk payloads, each starting on a 16-byte boundary
+#(loaders also accept the older layout: chunks back-to-back, each as magic + size + payload)
+
+import os
+import struct
+
+BLOB_VERSION = 1
+ALIGNMENT = 16
+
+def fnv1a(data):
+	h = 0x811c9dc5
+	for b in data:
+		h = ((h ^ b) * 0x01000193) & 0xffffffff
+	return h
+
+#hash of a mesh name, checked against the other names in the same file ('hashes' maps hash -> name);
+# loaders look meshes up by hash alone, so two names with the same hash are an error:
+def name_hash(name, hashes):
+	h = fnv1a(bytes(name, "utf8"))
+	if h in hashes and hashes[h] != name:
+		raise Exception("Names '" + hashes[h] + "' and '" + name + "' have the same hash; rename one of them.")
+	hashes[h] = name
+	return h
+
+#chunks is a list of (magic, payload) pairs; magic is a 4-byte bytes object:
+def write_blob(filename, chunks):
+	def align(x):
+		return (x + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+	offset = align(16 + 16 * len(chunks))
+	table = b''
+	for (magic, payload) in chunks:
+		assert(len(magic) == 4)
+		table += struct.pack('<4sIII', magic, offset, len(payload), fnv1a(payload))
+		offset = align(offset + len(payload))
+
+	#write to a temporary file, then swap it in, so a reader never sees (or has mapped) a half-written file:
+	temp = filename + '.tmp'
+	blob = open(temp, 'wb')
+	blob.write(struct.pack('<4sIII', b'blob', BLOB_VERSION, len(chunks), 0))
+	blob.write(table)
+	for (magic, payload) in chunks:
+		blob.write(b'\0' * (align(blob.tell()) - blob.tell()))
+		blob.write(payload)
+	size = blob.tell()
+	blob.close()
+	os.replace(temp, filename)
+	return size
@@ -4,6 +4,9 @@
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *_to) {
@@ -29,7 +32,153 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 	}
 
 	to.resize(header.size / sizeof(T));
-	if (!from.read(reinterpret_cast< char * >(&to[0]), to.size() * sizeof(T))) {
+	if (!to.empty() && !from.read(reinterpret_cast< char * >(&to[0]), to.size() * sizeof(T))) {
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
+
+//ChunkSpan views a chunk's payload in place (e.g., inside a MappedFile):
+// payloads aren't necessarily aligned for T, so elements are copied out on access.
+template< typename T >
+struct ChunkSpan {
+	uint8_t const *bytes = nullptr;
+	size_t count = 0;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	size_t size_bytes() const { return count * sizeof(T); }
+	T operator[](size_t i) const {
+		assert(i < count);
+		T t;
+		std::memcpy(reinterpret_cast< void * >(&t), bytes + i * sizeof(T), sizeof(T));
+		return t;
+	}
+};
+
+//FNV-1a hash; used as the per-chunk checksum in blob chunk tables:
+inline uint32_t blob_checksum(uint8_t const *data, size_t size) {
+	uint32_t h = 0x811c9dc5;
+	for (size_t i = 0; i < size; ++i) {
+		h = (h ^ data[i]) * 0x01000193;
+	}
+	return h;
+}
+
+//ChunkReader finds chunks in an in-memory blob without copying them.
+// Blobs that start with a chunk table (see models/write_blob.py) can have their chunks read in any order,
+// and chunks the loader doesn't ask for are simply skipped; older blobs (chunks back-to-back with no table)
+// must be read in file order, as with read_chunk().
+struct ChunkReader {
+	struct BlobHeader {
+		char magic[4]; //"blob"
+		uint32_t version;
+		uint32_t chunk_count;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(BlobHeader) == 16, "header is packed");
+	struct TableEntry {
+		char magic[4];
+		uint32_t offset; //from start of blob
+		uint32_t size;
+		uint32_t checksum; //blob_checksum() of the payload
+	};
+	static_assert(sizeof(TableEntry) == 16, "table entry is packed");
+	static constexpr uint32_t Version = 1;
+
+	//note: throws if the blob claims to have a table but it is malformed.
+	ChunkReader(uint8_t const *data_, size_t size_) : data(data_), size(size_) {
+		BlobHeader header;
+		if (size < sizeof(header)) return;
+		std::memcpy(&header, data, sizeof(header));
+		if (std::string(header.magic,4) != "blob") return; //legacy layout
+
+		if (header.version != Version) {
+			throw std::runtime_error("Unsupported blob version " + std::to_string(header.version));
+		}
+		if ((size - sizeof(header)) / sizeof(TableEntry) < header.chunk_count) {
+			throw std::runtime_error("Blob chunk table extends past end of file");
+		}
+		table.resize(header.chunk_count);
+		if (!table.empty()) {
+			std::memcpy(&table[0], data + sizeof(header), table.size() * sizeof(TableEntry));
+		}
+		for (auto const &entry : table) {
+			if (entry.offset > size || size - entry.offset < entry.size) {
+				throw std::runtime_error("Blob chunk '" + std::string(entry.magic,4) + "' extends past end of file");
+			}
+		}
+		has_table = true;
+	}
+
+	//same checks as read_chunk(), but 'to' ends up pointing into the blob:
+	template< typename T >
+	void read(std::string const &magic, ChunkSpan< T > *to) {
+		assert(to);
+		uint32_t chunk_size = 0;
+		uint8_t const *chunk = find(magic, &chunk_size);
+		if (chunk_size % sizeof(T) != 0) {
+			throw std::runtime_error("Size of chunk not divisible by element size");
+		}
+		to->bytes = chunk;
+		to->count = chunk_size / sizeof(T);
+	}
+
+	//is there a chunk with this magic? (only answerable for blobs with a table):
+	bool has(std::string const &magic) const {
+		for (auto const &entry : table) {
+			if (std::string(entry.magic,4) == magic) return true;
+		}
+		return false;
+	}
+
+	//has everything in the blob been read? (blobs with a table are allowed to have unread chunks):
+	bool at_end() const { return has_table || offset == size; }
+
+	//payload of the chunk named 'magic' (checking its checksum, if there is a table):
+	uint8_t const *find(std::string const &magic, uint32_t *chunk_size) {
+		assert(chunk_size);
+		if (has_table) {
+			for (auto const &entry : table) {
+				if (std::string(entry.magic,4) != magic) continue;
+				if (verify_checksums && blob_checksum(data + entry.offset, entry.size) != entry.checksum) {
+					throw std::runtime_error("Checksum mismatch in chunk '" + magic + "'");
+				}
+				*chunk_size = entry.size;
+				return data + entry.offset;
+			}
+			throw std::runtime_error("Blob has no chunk '" + magic + "'");
+		}
+
+		struct ChunkHeader {
+			char magic[4];
+			uint32_t size;
+		};
+		static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+		if (size - offset < sizeof(ChunkHeader)) {
+			throw std::runtime_error("Failed to read chunk header");
+		}
+		ChunkHeader header;
+		std::memcpy(&header, data + offset, sizeof(header));
+		offset += sizeof(header);
+		if (std::string(header.magic,4) != magic) {
+			throw std::runtime_error("Unexpected magic number in chunk");
+		}
+		if (size - offset < header.size) {
+			throw std::runtime_error("Failed to read chunk data.");
+		}
+		uint8_t const *chunk = data + offset;
+		offset += header.size;
+		*chunk_size = header.size;
+		return chunk;
+	}
+
+	uint8_t const *data;
+	size_t size;
+	bool verify_checksums = true;
+
+	//internals:
+	bool has_table = false;
+	std::vector< TableEntry > table;
+	size_t offset = 0; //read position (legacy layout)
+};